@@ -0,0 +1,432 @@
+// Headless benchmark suite: collision, grid, level loading and collection
+// indexing, deadlock checks, mesh import and job system scaling over
+// synthetic fixtures at several scales. Iteration counts are fixed per case
+// so runs are comparable between commits; results go out as JSON.
+//   bench [--out results.json] [--filter substring] [--reps N]
+#include "simulation.h"
+#include "model.h"
+#include "level_gen.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+double nowNs(){
+    using namespace std::chrono;
+    return (double)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// keeps results alive without printing them
+volatile double gSink = 0.0;
+
+// ---- fixtures ----
+
+// random-mode level from the shared generator, written to the temp dir
+std::string writeLevel(int w, int h, float wallDensity, int crates, uint32_t seed){
+    LevelGenParams p;
+    p.mode = LevelGenParams::Mode::Random;
+    p.width = w; p.height = h;
+    p.wallDensity = wallDensity;
+    p.crates = crates;
+    p.seed = seed;
+    GeneratedLevel level;
+    generateLevel(p, level);
+    auto path = std::filesystem::temp_directory_path() /
+        ("sokoban_bench_" + std::to_string(w) + "x" + std::to_string(h) + "_" + std::to_string(seed) + ".txt");
+    level.save(path.string());
+    return path.string();
+}
+
+// `levels` boards of size x size in .xsb notation, each with a comment
+// number before it and a Title: line after, written to the temp dir;
+// empty when no board could be generated or the file not written
+std::string writeCollection(int levels, int size){
+    std::vector<std::string> boards;
+    for(uint32_t seed=1; seed<=8; ++seed){
+        Grid g;
+        if(!g.load(writeLevel(size, size, 0.2f, size / 2, seed))) continue;
+        std::string b;
+        for(int y=g.H-1; y>=0; --y){
+            for(int x=0; x<g.W; ++x){
+                glm::ivec2 p(x, y);
+                bool goal = g.isGoal(p), box = g.occupiedByBox(p), wall = g.isWall(p) || x==0 || y==0 || x==g.W-1 || y==g.H-1;
+                b += p == g.player ? (goal ? '+' : '@') : box ? (goal ? '*' : '$') : goal ? '.' : wall ? '#' : ' ';
+            }
+            b += '\n';
+        }
+        boards.push_back(b);
+    }
+    if(boards.empty()){
+        std::fprintf(stderr, "collection fixture: no %dx%d board generated\n", size, size);
+        return {};
+    }
+    auto path = std::filesystem::temp_directory_path() /
+        ("sokoban_bench_" + std::to_string(levels) + "_levels.xsb");
+    std::FILE* f = std::fopen(path.string().c_str(), "wb");
+    if(!f) return {};
+    for(int i=0; i<levels; ++i)
+        std::fprintf(f, "; %d\n\n%sTitle: Level %d\nAuthor: bench\n\n", i + 1, boards[i % boards.size()].c_str(), i + 1);
+    std::fclose(f);
+    return path.string();
+}
+
+// w x h vertex grid as an Assimp mesh (what an importer hands processMesh)
+aiMesh* makeAiGrid(int w, int h){
+    aiMesh* m = new aiMesh();
+    m->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+    m->mNumVertices = (unsigned)(w*h);
+    m->mVertices = new aiVector3D[m->mNumVertices];
+    m->mNormals = new aiVector3D[m->mNumVertices];
+    m->mTextureCoords[0] = new aiVector3D[m->mNumVertices];
+    m->mNumUVComponents[0] = 2;
+    for(int y=0; y<h; ++y)
+        for(int x=0; x<w; ++x){
+            unsigned i = (unsigned)(y*w + x);
+            m->mVertices[i] = aiVector3D((float)x, std::sin(x*0.1f) * std::cos(y*0.1f), (float)y);
+            m->mNormals[i] = aiVector3D(0, 1, 0);
+            m->mTextureCoords[0][i] = aiVector3D(x / (float)w, y / (float)h, 0);
+        }
+    m->mNumFaces = (unsigned)((w-1)*(h-1)*2);
+    m->mFaces = new aiFace[m->mNumFaces];
+    unsigned f = 0;
+    for(int y=0; y<h-1; ++y)
+        for(int x=0; x<w-1; ++x){
+            unsigned a = (unsigned)(y*w + x), b = a+1, c = a+(unsigned)w, d = c+1;
+            for(auto tri : { std::array<unsigned,3>{a,c,b}, std::array<unsigned,3>{b,c,d} }){
+                aiFace& face = m->mFaces[f++];
+                face.mNumIndices = 3;
+                face.mIndices = new unsigned[3]{ tri[0], tri[1], tri[2] };
+            }
+        }
+    return m;
+}
+
+// ---- runner ----
+
+struct Result {
+    std::string name, params;
+    long iterations;
+    double minNs, medianNs;    // per iteration, over the repetitions
+};
+
+struct Runner {
+    std::string filter;
+    int reps = 5;
+    std::vector<Result> results;
+
+    // whether run(name, params, ...) would run; cases check it before
+    // building their fixtures
+    bool wants(const std::string& name, const std::string& params) const {
+        return filter.empty() || (name + "/" + params).find(filter) != std::string::npos;
+    }
+
+    // setup runs once; body(iterations) is timed reps times after one warm-up
+    void run(const std::string& name, const std::string& params, long iterations,
+             const std::function<void(long)>& body){
+        if(!wants(name, params)) return;
+        body(iterations);   // warm-up
+        std::vector<double> per;
+        for(int r=0; r<reps; ++r){
+            double t0 = nowNs();
+            body(iterations);
+            per.push_back((nowNs() - t0) / iterations);
+        }
+        std::sort(per.begin(), per.end());
+        results.push_back({ name, params, iterations, per.front(), per[per.size()/2] });
+        std::fprintf(stderr, "%-22s %-28s %12.1f ns/iter\n", name.c_str(), params.c_str(), per[per.size()/2]);
+    }
+
+    void writeJson(std::FILE* f) const {
+#if defined(SOKOBAN_SWEEP_AVX)
+        const char* path = "avx";
+#elif defined(SOKOBAN_SWEEP_SSE)
+        const char* path = "sse2";
+#else
+        const char* path = "scalar";
+#endif
+        std::fprintf(f, "{\n  \"suite\": \"sokoban\",\n  \"simd\": \"%s\",\n  \"reps\": %d,\n  \"results\": [\n", path, reps);
+        for(size_t i=0; i<results.size(); ++i){
+            const Result& r = results[i];
+            std::fprintf(f, "    {\"name\": \"%s\", \"params\": \"%s\", \"iterations\": %ld, \"min_ns\": %.3f, \"median_ns\": %.3f}%s\n",
+                         r.name.c_str(), r.params.c_str(), r.iterations, r.minNs, r.medianNs,
+                         i+1 < results.size() ? "," : "");
+        }
+        std::fprintf(f, "  ]\n}\n");
+    }
+};
+
+std::string sizeParam(int w, int h){ return std::to_string(w) + "x" + std::to_string(h); }
+
+// ---- cases ----
+
+void benchSweep(Runner& R){
+    for(int n : {64, 1024, 16384}){
+        const std::string params = "targets=" + std::to_string(n);
+        if(!R.wants("sweepAABB", params) && !R.wants("sweepAABBBatch", params)) continue;
+        std::mt19937 rng(7);
+        float side = std::sqrt((float)n) * 2.0f;
+        std::uniform_real_distribution<float> pos(0.0f, side), dir(-1.0f, 1.0f);
+        std::vector<AABB> targets(n);
+        AABBSoA soa; soa.reserve(n);
+        for(auto& t : targets){ t = { glm::vec2(pos(rng), pos(rng)), glm::vec2(0.5f) }; soa.push(t); }
+        const int queries = 256;
+        std::vector<AABB> movers(queries);
+        std::vector<glm::vec2> deltas(queries);
+        for(int q=0; q<queries; ++q){
+            movers[q] = { glm::vec2(pos(rng), pos(rng)), glm::vec2(0.38f) };
+            deltas[q] = glm::vec2(dir(rng), dir(rng)) * side * 0.25f;
+        }
+        // one iteration = one mover against every target
+        long iters = std::max(256L, 4'000'000L / n);
+        R.run("sweepAABB", params, iters, [&](long it){
+            double s = 0;
+            for(long i=0; i<it; ++i){
+                int q = (int)(i % queries);
+                for(const auto& t : targets) s += sweepAABB(movers[q], deltas[q], t).toi;
+            }
+            gSink = gSink + s;
+        });
+        R.run("sweepAABBBatch", params, iters, [&](long it){
+            double s = 0;
+            for(long i=0; i<it; ++i){ int q = (int)(i % queries); s += sweepAABBBatch(movers[q], deltas[q], soa).toi; }
+            gSink = gSink + s;
+        });
+    }
+}
+
+void benchMoveAndCollide(Runner& R){
+    for(int size : {16, 256, 2048}){
+        for(float density : {0.05f, 0.30f}){
+            char params[64];
+            std::snprintf(params, sizeof params, "map=%s,walls=%.2f", sizeParam(size, size).c_str(), density);
+            if(!R.wants("moveAndCollide", params)) continue;
+            Grid g;
+            if(!g.load(writeLevel(size, size, density, 0, 11))) continue;
+            std::mt19937 rng(3);
+            std::uniform_real_distribution<float> dir(-1.0f, 1.0f);
+            std::vector<glm::vec2> steps(1024);
+            for(auto& d : steps) d = glm::normalize(glm::vec2(dir(rng), dir(rng)) + glm::vec2(1e-3f)) * (5.0f / 60.0f);
+            AABB start{ glm::vec2(g.player), glm::vec2(0.38f) };
+            R.run("moveAndCollide", params, 100000, [&](long it){
+                AABB p = start;
+                glm::vec2 n;
+                for(long i=0; i<it; ++i) moveAndCollide(p, steps[i % steps.size()], g, &n);
+                gSink = gSink + p.center.x;
+            });
+        }
+    }
+}
+
+// crates pushed back and forth along one axis through Simulation::tryMoveBox
+void benchPush(Runner& R){
+    for(int crates : {4, 256, 4096}){
+        int size = std::max(32, (int)std::sqrt((float)crates) * 8);
+        const std::string params = "crates=" + std::to_string(crates) + ",map=" + sizeParam(size, size);
+        if(!R.wants("tryMoveBox", params)) continue;
+        Simulation sim;
+        sim.levels = { writeLevel(size, size, 0.02f, crates, 5) };
+        sim.loadCurrentLevel();
+        if(sim.crates.empty()) continue;
+        const glm::vec2 step(5.0f / 60.0f, 0.0f);
+        R.run("tryMoveBox", params, 100000, [&](long it){
+            glm::vec2 moved;
+            for(long i=0; i<it; ++i){
+                size_t j = (size_t)(i % (long)sim.crates.size());
+                sim.tryMoveBox(j, ((i / (long)sim.crates.size()) & 8) ? -step : step, &moved);
+            }
+            gSink = gSink + moved.x;
+        });
+    }
+}
+
+// dead squares per level, then one crate stepped back and forth per move
+// (the per-push cost the game pays); dense maps close more corrals. Crate
+// counts in the params are the requested ones, all placed at these sizes.
+void benchDeadlock(Runner& R){
+    const int crates = 1000;
+    for(int size : {96, 256}){
+        const std::string params = "crates=" + std::to_string(crates) + ",map=" + sizeParam(size, size);
+        if(!R.wants("DeadlockAnalyzer::build", params) && !R.wants("DeadlockAnalyzer::moveCrate", params)) continue;
+        Grid g;
+        if(!g.load(writeLevel(size, size, 0.2f, crates, 13))) continue;
+        DeadlockAnalyzer a;
+        R.run("DeadlockAnalyzer::build", params, 20, [&](long it){
+            for(long i=0; i<it; ++i) a.build(g);
+            gSink = gSink + (double)a.deadSquares();
+        });
+        a.reset(g.boxes);
+        struct Move { glm::ivec2 from, to; };
+        std::vector<Move> moves;
+        for(const auto& b : g.boxes)
+            for(glm::ivec2 d : { glm::ivec2(1,0), glm::ivec2(0,1), glm::ivec2(-1,0), glm::ivec2(0,-1) })
+                if(!g.isWall(b + d) && !g.isWall(b - d) && !g.occupiedByBox(b + d) && !g.occupiedByBox(b - d)){
+                    moves.push_back({ b, b + d });
+                    break;
+                }
+        if(moves.empty()) continue;
+        R.run("DeadlockAnalyzer::moveCrate", params, 20000, [&](long it){
+            for(long i=0; i<it; ++i){
+                const Move& m = moves[(size_t)(i / 2) % moves.size()];
+                if(i & 1) a.moveCrate(m.to, m.from, m.to);      // player ends where the crate was
+                else      a.moveCrate(m.from, m.to, m.from);
+            }
+            gSink = gSink + (double)a.deadlocks().size();
+        });
+        std::fprintf(stderr, "  deadlock checks %llu, corral searches %llu (%llu nodes), worst move %.1f us\n",
+                     (unsigned long long)a.stats.checks, (unsigned long long)a.stats.corralSearches,
+                     (unsigned long long)a.stats.corralNodes, a.stats.maxUs);
+    }
+}
+
+void benchGrid(Runner& R){
+    for(int size : {64, 512, 2048}){
+        const std::string params = "map=" + sizeParam(size, size);
+        if(!R.wants("Grid::load", params) && !R.wants("Grid::load(sokb)", params) && !R.wants("Grid::moveBox", params)) continue;
+        std::string path = writeLevel(size, size, 0.2f, size / 4, 9);
+        long loads = std::max(2L, 2'000'000L / ((long)size*size));
+        R.run("Grid::load", params, loads, [&](long it){
+            Grid g;
+            for(long i=0; i<it; ++i) g.load(path);
+            gSink = gSink + g.W;
+        });
+        Grid g;
+        g.load(path);
+        const std::string binPath = path + ".sokb";
+        g.saveBinary(binPath);
+        R.run("Grid::load(sokb)", params, loads, [&](long it){
+            Grid b;
+            for(long i=0; i<it; ++i) b.load(binPath);
+            gSink = gSink + b.W;
+        });
+        // win() reads the goal count moveBox() keeps up, so time that upkeep:
+        // each box with a free neighbour stepped there and back
+        struct Step { int box; glm::ivec2 from, to; };
+        std::vector<Step> steps;
+        for(size_t i=0; i<g.boxes.size(); ++i)
+            for(glm::ivec2 d : { glm::ivec2(1,0), glm::ivec2(0,1), glm::ivec2(-1,0), glm::ivec2(0,-1) }){
+                glm::ivec2 to = g.boxes[i] + d;
+                if(g.isWall(to) || g.occupiedByBox(to)) continue;
+                steps.push_back({ (int)i, g.boxes[i], to });
+                break;
+            }
+        if(steps.empty()) continue;
+        R.run("Grid::moveBox", params, 100000, [&](long it){
+            int wins = 0;
+            for(long i=0; i<it; ++i){
+                const Step& m = steps[(size_t)(i / 2) % steps.size()];
+                g.moveBox(m.box, (i & 1) ? m.from : m.to);
+                wins += g.win();
+            }
+            gSink = gSink + wins;
+        });
+    }
+}
+
+// one-pass index of a whole collection, then title lookup and decoding a
+// single level on demand
+void benchCollection(Runner& R){
+    for(int levels : {1000, 10000}){
+        const std::string params = "levels=" + std::to_string(levels);
+        if(!R.wants("LevelCollection::open", params) && !R.wants("LevelCollection::find", params + " title=last")
+           && !R.wants("Grid::load(collection)", params + " map=16x16")) continue;
+        std::string path = writeCollection(levels, 16);
+        if(path.empty()) continue;
+        R.run("LevelCollection::open", params, 10, [&](long it){
+            LevelCollection c;
+            for(long i=0; i<it; ++i) c.open(path);
+            gSink = gSink + (double)c.size();
+        });
+        LevelCollection c;
+        if(!c.open(path) || c.size() == 0) continue;
+        const std::string last = "Level " + std::to_string(levels);
+        R.run("LevelCollection::find", params + " title=last", 100, [&](long it){
+            long found = 0;
+            for(long i=0; i<it; ++i) found += c.find(last);
+            gSink = gSink + (double)found;
+        });
+        R.run("Grid::load(collection)", params + " map=16x16", 10000, [&](long it){
+            Grid g;
+            for(long i=0; i<it; ++i) g.load(c, (size_t)(i * 7919) % c.size());
+            gSink = gSink + g.W;
+        });
+    }
+}
+
+void benchProcessMesh(Runner& R){
+    for(int side : {16, 128, 512}){
+        const std::string params = "verts=" + std::to_string(side*side);
+        if(!R.wants("Model::processMesh", params)) continue;
+        aiMesh* a = makeAiGrid(side, side);
+        Model model;
+        long iters = std::max(4L, 1'000'000L / ((long)side*side));
+        R.run("Model::processMesh", params, iters, [&](long it){
+            size_t n = 0;
+            for(long i=0; i<it; ++i) n += model.processMesh(a, nullptr).indices.size();
+            gSink = gSink + (double)n;
+        });
+        delete a;
+    }
+}
+
+// crate interpolation spread over 1, 2, 4, ... threads up to the core count
+// (all requested crates fit on the map)
+void benchJobs(Runner& R){
+    const int crates = 200000;
+    const int cores = (int)std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> counts;
+    for(int threads=1; ; threads = std::min(threads * 2, cores)){
+        if(R.wants("Simulation::syncWorld", "crates=" + std::to_string(crates) + ",threads=" + std::to_string(threads))) counts.push_back(threads);
+        if(threads == cores) break;
+    }
+    if(counts.empty()) return;
+    Simulation sim;
+    sim.levels = { writeLevel(1024, 1024, 0.02f, crates, 11) };
+    sim.loadCurrentLevel();
+    if(sim.crates.empty()) return;
+    for(int threads : counts){
+        JobSystem jobs(threads);
+        R.run("Simulation::syncWorld", "crates=" + std::to_string(crates) + ",threads=" + std::to_string(threads), 200, [&](long it){
+            for(long i=0; i<it; ++i) sim.syncWorld((float)(i & 7) / 8.0f, &jobs);
+            gSink = gSink + sim.crates.world[0].x;
+        });
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv){
+    Runner R;
+    const char* out = nullptr;
+    for(int i=1; i<argc; ++i){
+        if(!std::strcmp(argv[i], "--out") && i+1<argc) out = argv[++i];
+        else if(!std::strcmp(argv[i], "--filter") && i+1<argc) R.filter = argv[++i];
+        else if(!std::strcmp(argv[i], "--reps") && i+1<argc) R.reps = std::max(1, std::atoi(argv[++i]));
+        else { std::fprintf(stderr, "usage: bench [--out file.json] [--filter substring] [--reps N]\n"); return 2; }
+    }
+
+    benchSweep(R);
+    benchMoveAndCollide(R);
+    benchPush(R);
+    benchDeadlock(R);
+    benchGrid(R);
+    benchCollection(R);
+    benchProcessMesh(R);
+    benchJobs(R);
+
+    std::FILE* f = out ? std::fopen(out, "w") : stdout;
+    if(!f){ std::fprintf(stderr, "cannot write %s\n", out); return 1; }
+    R.writeJson(f);
+    if(out) std::fclose(f);
+    return 0;
+}
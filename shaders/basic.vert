@@ -2,20 +2,49 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTex;
+layout (location = 3) in mat4 aInstModel;   // 3..6, per instance
+layout (location = 7) in vec3 aInstColor;   // per instance
+// constant per mesh (Mesh::bindDequant): pos = offset + aPos * scale;
+// offset.w = 1 when aNormal.xy is an octahedral encoding
+layout (location = 8) in vec4 aDequantOffset;
+layout (location = 9) in vec3 aDequantScale;
+
+// per-frame data, one buffer update per frame (FrameUniforms in uniform_buffer.h)
+layout (std140) uniform Frame {
+    mat4 uView;
+    mat4 uProj;
+    vec4 uCamPos;
+    vec4 uLightDir;
+    vec4 uLightColor;
+};
 
 uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uProj;
+uniform vec3 uColor;
+uniform bool uInstanced;
 
 out vec3 vNormal;
 out vec3 vWorldPos;
 out vec2 vTex;
+out vec3 vColor;
+
+vec3 octDecode(vec2 e){
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if(n.z < 0.0){
+        vec2 s = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+        n.xy = (1.0 - abs(n.yx)) * s;
+    }
+    return normalize(n);
+}
 
 void main(){
-    vec4 world = uModel * vec4(aPos, 1.0);
+    mat4 model = uInstanced ? aInstModel : uModel;
+    vec3 pos = aDequantOffset.xyz + aPos * aDequantScale;
+    vec3 nrm = aDequantOffset.w > 0.5 ? octDecode(aNormal.xy) : aNormal;
+    vec4 world = model * vec4(pos, 1.0);
     vWorldPos = world.xyz;
-    mat3 nmat = mat3(transpose(inverse(uModel)));
-    vNormal = normalize(nmat * aNormal);
+    mat3 nmat = mat3(transpose(inverse(model)));
+    vNormal = normalize(nmat * nrm);
     vTex = aTex;
+    vColor = uInstanced ? aInstColor : uColor;
     gl_Position = uProj * uView * world; 
 }
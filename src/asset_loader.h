@@ -0,0 +1,116 @@
+#pragma once
+#include "model.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Background model loading. Workers run Model::loadCPU (cache read or Assimp
+// import + processMesh); finished models queue up for the main thread, which
+// calls pump() once a frame to do the GL uploads within a time budget.
+class AssetLoader {
+public:
+    using Done = std::function<void(bool ok)>;   // main thread, after the last upload
+
+    explicit AssetLoader(int threads = 0){
+        if(threads <= 0) threads = (int)std::clamp(std::thread::hardware_concurrency(), 1u, 4u);
+        start = std::chrono::steady_clock::now();
+        for(int i=0; i<threads; ++i) pool.emplace_back([this]{ workerLoop(); });
+    }
+    ~AssetLoader(){
+        {
+            std::lock_guard<std::mutex> lk(m);
+            quit = true;
+        }
+        cv.notify_all();
+        for(auto& t : pool) t.join();
+    }
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    // first candidate that loads wins (e.g. .gltf then .obj); `model` must
+    // outlive the loader and is not touched by the caller until done runs
+    void request(Model* model, std::vector<std::string> candidates, Done done){
+        {
+            std::lock_guard<std::mutex> lk(m);
+            jobs.push_back(Job{ model, std::move(candidates), std::move(done), false });
+            ++outstanding;
+        }
+        cv.notify_one();
+    }
+
+    // main thread: GL uploads until budgetMs is spent (at least one mesh per
+    // call so progress is guaranteed); returns models completed this call
+    int pump(double budgetMs){
+        auto t0 = std::chrono::steady_clock::now();
+        auto spent = [&]{ return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count(); };
+        int completed = 0;
+        for(;;){
+            if(!current){
+                std::lock_guard<std::mutex> lk(m);
+                if(ready.empty()) break;
+                current = std::make_unique<Job>(std::move(ready.front()));
+                ready.pop_front();
+            }
+            bool finished = !current->ok || current->model->uploadNext();
+            if(finished){
+                if(current->done) current->done(current->ok);
+                current.reset();
+                ++completed;
+                if(--outstanding == 0) totalMs = elapsedMs();
+            }
+            if(spent() >= budgetMs) break;
+        }
+        return completed;
+    }
+
+    bool idle() const { return outstanding == 0; }
+    // wall time from construction until the last model finished (0 while busy)
+    double totalLoadMs() const { return totalMs; }
+    double elapsedMs() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    struct Job {
+        Model* model;
+        std::vector<std::string> candidates;
+        Done done;
+        bool ok;
+    };
+
+    std::vector<std::thread> pool;
+    std::mutex m;
+    std::condition_variable cv;
+    std::deque<Job> jobs;       // waiting for a worker
+    std::deque<Job> ready;      // CPU side done, waiting for GL upload
+    std::unique_ptr<Job> current;
+    int outstanding = 0;        // main thread only
+    bool quit = false;
+    double totalMs = 0.0;
+    std::chrono::steady_clock::time_point start;
+
+    void workerLoop(){
+        PROF_THREAD_NAME("asset worker");
+        for(;;){
+            Job job;
+            {
+                std::unique_lock<std::mutex> lk(m);
+                cv.wait(lk, [&]{ return quit || !jobs.empty(); });
+                if(quit) return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            for(const auto& path : job.candidates)
+                if((job.ok = job.model->loadCPU(path))) break;
+            std::lock_guard<std::mutex> lk(m);
+            ready.push_back(std::move(job));
+        }
+    }
+};
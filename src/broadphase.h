@@ -0,0 +1,90 @@
+#pragma once
+#include "collision.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Loose spatial hash for moving bodies (crates). Each body lives in the one
+// cell that holds its centre; queries widen the search by the largest half
+// extent seen, so a body is a candidate whenever its AABB could touch the
+// query box. update() only touches the hash when the centre changes cell.
+struct BodyHash {
+    struct Stats {
+        uint64_t queries = 0;
+        uint64_t narrowTests = 0;    // candidates handed to the caller (f calls)
+        uint64_t narrowSkipped = 0;  // tests a brute-force loop would have made on top
+    };
+
+    float cellSize = 1.0f;
+    Stats stats;
+
+    void clear(){
+        cells.clear();
+        keyOf.clear();
+        maxHalf = 0.0f;
+    }
+
+    // ids are dense 0..n-1 (EntityStore slots of the crates)
+    void insert(int id, const AABB& box){
+        if((int)keyOf.size() <= id) keyOf.resize(id + 1, kNone);
+        maxHalf = std::max(maxHalf, std::max(box.half.x, box.half.y));
+        uint64_t k = keyFor(box.center);
+        keyOf[id] = k;
+        cells[k].push_back(id);
+    }
+
+    void update(int id, const AABB& box){
+        uint64_t k = keyFor(box.center);
+        if(keyOf[id] == k) return;
+        auto& from = cells[keyOf[id]];
+        auto it = std::find(from.begin(), from.end(), id);
+        if(it != from.end()){ *it = from.back(); from.pop_back(); }
+        keyOf[id] = k;
+        cells[k].push_back(id);
+    }
+
+    int size() const { return (int)keyOf.size(); }
+
+    // f(id) for every body that may overlap [lo,hi], in ascending id order so
+    // "first hit wins" loops behave exactly like a scan over the whole list.
+    // Return false from f to stop early.
+    template<class F>
+    void query(glm::vec2 lo, glm::vec2 hi, F&& f){
+        const float pad = maxHalf + 1e-3f;
+        int x0 = cellOf(lo.x - pad), x1 = cellOf(hi.x + pad);
+        int y0 = cellOf(lo.y - pad), y1 = cellOf(hi.y + pad);
+        scratch.clear();
+        for(int y=y0; y<=y1; ++y)
+            for(int x=x0; x<=x1; ++x){
+                auto it = cells.find(pack(x, y));
+                if(it == cells.end()) continue;
+                scratch.insert(scratch.end(), it->second.begin(), it->second.end());
+            }
+        std::sort(scratch.begin(), scratch.end());
+        stats.queries++;
+        uint64_t tested = 0;
+        int stop = -1;
+        for(int id : scratch){
+            ++tested;
+            if(!f(id)){ stop = id; break; }
+        }
+        // the brute-force loop scans ids in the same order and stops at the
+        // same hit, so it tests bodies 0..stop (or all of them)
+        stats.narrowTests += tested;
+        stats.narrowSkipped += (stop >= 0 ? (uint64_t)stop + 1 : (uint64_t)keyOf.size()) - tested;
+    }
+
+private:
+    static constexpr uint64_t kNone = ~0ull;
+    std::unordered_map<uint64_t, std::vector<int>> cells;
+    std::vector<uint64_t> keyOf;
+    std::vector<int> scratch;
+    float maxHalf = 0.0f;
+
+    int cellOf(float v) const { return (int)std::floor(v / cellSize); }
+    static uint64_t pack(int x, int y){ return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y; }
+    uint64_t keyFor(glm::vec2 c) const { return pack(cellOf(c.x), cellOf(c.y)); }
+};
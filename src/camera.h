@@ -1,6 +1,8 @@
 #pragma once
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
 
 struct Camera {
     glm::vec3 pos{0,3,6};
@@ -18,6 +20,11 @@ struct Camera {
     glm::mat4 proj() const {
         return glm::perspective(glm::radians(fov), aspect, nearP, farP);
     }
+    // screen pixels covered by one world unit at p (vertical, viewport height h)
+    float pixelsPerUnit(const glm::vec3& p, float viewportH) const {
+        float d = glm::length(p - pos);
+        return viewportH * 0.5f / (std::max(d, nearP) * std::tan(glm::radians(fov) * 0.5f));
+    }
     void follow(const glm::vec3& p){
         if(topDown){
             pos = p + glm::vec3(0, 10.0f, 0.001f);
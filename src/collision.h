@@ -1,7 +1,18 @@
 #pragma once
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
 #include <limits>
 #include <vector>
+#include "profiler.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SOKOBAN_SWEEP_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOKOBAN_SWEEP_SSE 1
+#endif
 
 // เราทำคอลิชันบนระนาบ XZ (Y ใช้แค่ความสูงโมเดล)
 struct AABB {
@@ -59,11 +70,195 @@ inline SweepHit sweepAABB(const AABB& moving, const glm::vec2& delta, const AABB
     return hit;
 }
 
-// move and collide vs list (static geometry)
-inline float moveAndCollide(AABB& mover, glm::vec2 delta,
-                            const std::vector<AABB>& statics,
-                            glm::vec2* outNormal=nullptr)
+// ---- batch sweep: one mover vs N targets stored as structure-of-arrays ----
+// The SIMD paths replay sweepAABB's arithmetic op for op (same operand order
+// for min/max, same 1/rd, no fused ops), so the selected toi/index/normal are
+// bit-identical to running sweepAABB over the list and keeping the first
+// strictly smaller toi.
+struct AABBSoA {
+    std::vector<float> cx, cz, hx, hz;
+
+    void clear(){ cx.clear(); cz.clear(); hx.clear(); hz.clear(); }
+    void reserve(size_t n){ cx.reserve(n); cz.reserve(n); hx.reserve(n); hz.reserve(n); }
+    void push(const AABB& a){
+        cx.push_back(a.center.x); cz.push_back(a.center.y);
+        hx.push_back(a.half.x);   hz.push_back(a.half.y);
+    }
+    size_t size() const { return cx.size(); }
+    AABB get(size_t i) const { return { glm::vec2(cx[i], cz[i]), glm::vec2(hx[i], hz[i]) }; }
+};
+
+struct BatchHit {
+    float toi = 1.0f;      // 1 = ไม่ชน
+    glm::vec2 normal{0,0};
+    int index = -1;
+};
+
+// reference path: plain loop over sweepAABB
+inline BatchHit sweepAABBBatchScalar(const AABB& mover, glm::vec2 delta, const AABBSoA& t,
+                                     size_t begin = 0){
+    BatchHit best;
+    for(size_t i=begin; i<t.size(); ++i){
+        SweepHit h = sweepAABB(mover, delta, t.get(i));
+        if(h.toi < best.toi){ best.toi=h.toi; best.normal=h.normal; best.index=(int)i; }
+    }
+    return best;
+}
+
+#if defined(SOKOBAN_SWEEP_AVX) || defined(SOKOBAN_SWEEP_SSE)
+namespace sweep_simd {
+#if defined(SOKOBAN_SWEEP_AVX)
+    constexpr int W = 8;
+    using V = __m256; using VI = __m256i;
+    inline V load(const float* p){ return _mm256_loadu_ps(p); }
+    inline V set1(float v){ return _mm256_set1_ps(v); }
+    inline V add(V a, V b){ return _mm256_add_ps(a,b); }
+    inline V sub(V a, V b){ return _mm256_sub_ps(a,b); }
+    inline V mul(V a, V b){ return _mm256_mul_ps(a,b); }
+    inline V vmin(V a, V b){ return _mm256_min_ps(a,b); }   // a<b ? a : b
+    inline V vmax(V a, V b){ return _mm256_max_ps(a,b); }   // a>b ? a : b
+    inline V le(V a, V b){ return _mm256_cmp_ps(a,b,_CMP_LE_OQ); }
+    inline V ge(V a, V b){ return _mm256_cmp_ps(a,b,_CMP_GE_OQ); }
+    inline V lt(V a, V b){ return _mm256_cmp_ps(a,b,_CMP_LT_OQ); }
+    inline V gt(V a, V b){ return _mm256_cmp_ps(a,b,_CMP_GT_OQ); }
+    inline V vand(V a, V b){ return _mm256_and_ps(a,b); }
+    inline V blend(V a, V b, V m){ return _mm256_blendv_ps(a,b,m); } // m ? b : a
+    inline V iota(int base){ return _mm256_set_ps(base+7.f,base+6.f,base+5.f,base+4.f,base+3.f,base+2.f,base+1.f,(float)base); }
+    inline void store(float* p, V v){ _mm256_storeu_ps(p, v); }
+#else
+    constexpr int W = 4;
+    using V = __m128;
+    inline V load(const float* p){ return _mm_loadu_ps(p); }
+    inline V set1(float v){ return _mm_set1_ps(v); }
+    inline V add(V a, V b){ return _mm_add_ps(a,b); }
+    inline V sub(V a, V b){ return _mm_sub_ps(a,b); }
+    inline V mul(V a, V b){ return _mm_mul_ps(a,b); }
+    inline V vmin(V a, V b){ return _mm_min_ps(a,b); }
+    inline V vmax(V a, V b){ return _mm_max_ps(a,b); }
+    inline V le(V a, V b){ return _mm_cmple_ps(a,b); }
+    inline V ge(V a, V b){ return _mm_cmpge_ps(a,b); }
+    inline V lt(V a, V b){ return _mm_cmplt_ps(a,b); }
+    inline V gt(V a, V b){ return _mm_cmpgt_ps(a,b); }
+    inline V vand(V a, V b){ return _mm_and_ps(a,b); }
+    inline V blend(V a, V b, V m){ return _mm_or_ps(_mm_and_ps(m,b), _mm_andnot_ps(m,a)); }
+    inline V iota(int base){ return _mm_set_ps(base+3.f,base+2.f,base+1.f,(float)base); }
+    inline void store(float* p, V v){ _mm_storeu_ps(p, v); }
+#endif
+
+    // raySlab for one axis across W targets; updates t0/t1, returns ok mask
+    inline V slab(float ro, float rd, V slabMin, V slabMax, V& t0, V& t1){
+        V vro = set1(ro);
+        if(std::abs(rd) < 1e-8f) return vand(ge(vro, slabMin), le(vro, slabMax));
+        V inv = set1(1.0f / rd);
+        V tNear = mul(sub(slabMin, vro), inv);
+        V tFar  = mul(sub(slabMax, vro), inv);
+        V swap  = gt(tNear, tFar);
+        V n = blend(tNear, tFar, swap), f = blend(tFar, tNear, swap);
+        t0 = vmax(n, t0);     // == std::max(t0, n): keeps t0 on ties
+        t1 = vmin(f, t1);     // == std::min(t1, f): keeps t1 on ties
+        return le(t0, t1);
+    }
+}
+#endif
+
+// fastest available path; falls back to sweepAABBBatchScalar
+inline BatchHit sweepAABBBatch(const AABB& mover, glm::vec2 delta, const AABBSoA& t){
+#if defined(SOKOBAN_SWEEP_AVX) || defined(SOKOBAN_SWEEP_SSE)
+    using namespace sweep_simd;
+    const size_t n = t.size();
+    const size_t nv = n - n % W;
+    V bestToi = set1(1.0f), bestIdx = set1(-1.0f);
+    V mhx = set1(mover.half.x), mhz = set1(mover.half.y);
+    V zero = set1(0.0f), one = set1(1.0f);
+    for(size_t i=0; i<nv; i+=W){
+        V cx = load(&t.cx[i]), cz = load(&t.cz[i]);
+        V ex = add(load(&t.hx[i]), mhx), ez = add(load(&t.hz[i]), mhz);
+        V t0 = zero, t1 = one;
+        V okX = slab(mover.center.x, delta.x, sub(cx, ex), add(cx, ex), t0, t1);
+        V okZ = slab(mover.center.y, delta.y, sub(cz, ez), add(cz, ez), t0, t1);
+        V hit = vand(vand(okX, okZ), vand(ge(t0, zero), le(t0, one)));
+        V toi = blend(one, t0, hit);
+        V better = lt(toi, bestToi);
+        bestToi = blend(bestToi, toi, better);
+        bestIdx = blend(bestIdx, iota((int)i), better);
+    }
+    // lanes -> first index with the smallest toi (indices as float: exact below 2^24)
+    alignas(32) float laneToi[W], laneIdx[W];
+    store(laneToi, bestToi); store(laneIdx, bestIdx);
+    BatchHit best;
+    for(int l=0; l<W; ++l){
+        int idx = (int)laneIdx[l];
+        if(idx < 0) continue;
+        if(laneToi[l] < best.toi || (laneToi[l] == best.toi && idx < best.index)){ best.toi=laneToi[l]; best.index=idx; }
+    }
+    BatchHit tail = sweepAABBBatchScalar(mover, delta, t, nv);
+    if(tail.toi < best.toi) return tail;
+    if(best.index >= 0) best.normal = sweepAABB(mover, delta, t.get((size_t)best.index)).normal;
+    return best;
+#else
+    return sweepAABBBatchScalar(mover, delta, t);
+#endif
+}
+
+// Tile-grid queries: a tile (x,y) is the unit square centred on (x,y), the same
+// AABB loadCurrentLevel used to build per-wall colliders. TileGrid only needs
+// W, H and wallAt(x,y). Cells are visited y-major then x, matching the order
+// of the old wall list so equal-toi ties resolve to the same wall.
+inline AABB tileAABB(int x, int y){
+    return { glm::vec2((float)x, (float)y), glm::vec2(0.5f, 0.5f) };
+}
+
+// every wall tile touching [lo,hi] (inclusive, conservative by one ulp-ish pad)
+template<class TileGrid, class F>
+inline void forEachWallTile(const TileGrid& grid, glm::vec2 lo, glm::vec2 hi, F&& f){
+    const float pad = 1e-3f;
+    float fy0 = std::floor(lo.y - 0.5f - pad), fy1 = std::ceil(hi.y + 0.5f + pad);
+    float fx0 = std::floor(lo.x - 0.5f - pad), fx1 = std::ceil(hi.x + 0.5f + pad);
+    int y0 = (int)std::max(fy0, 0.0f), y1 = (int)std::min(fy1, (float)grid.H - 1);
+    int x0 = (int)std::max(fx0, 0.0f), x1 = (int)std::min(fx1, (float)grid.W - 1);
+    for(int y=y0; y<=y1; ++y)
+        for(int x=x0; x<=x1; ++x)
+            if(grid.wallAt(x, y)) f(tileAABB(x, y));
+}
+
+// every wall tile the swept box (box moved by delta over t in [0,1]) can touch.
+// Row by row: find the t-interval in which the box overlaps the row, then only
+// the x-span covered during that interval -> cost grows with distance moved,
+// not with the bounding box of a diagonal sweep or the number of walls.
+template<class TileGrid, class F>
+inline void forEachWallTileSwept(const TileGrid& grid, const AABB& box, glm::vec2 delta, F&& f){
+    const float pad = 1e-3f;
+    glm::vec2 a = box.center - box.half, b = box.center + box.half;
+    glm::vec2 lo = glm::min(a, a + delta), hi = glm::max(b, b + delta);
+    float fy0 = std::floor(lo.y - 0.5f - pad), fy1 = std::ceil(hi.y + 0.5f + pad);
+    int y0 = (int)std::max(fy0, 0.0f), y1 = (int)std::min(fy1, (float)grid.H - 1);
+    for(int y=y0; y<=y1; ++y){
+        float t0 = 0.0f, t1 = 1.0f;
+        if(std::abs(delta.y) > 1e-8f){
+            // box z-span [a.y + dz t, b.y + dz t] meets row [y-0.5, y+0.5]
+            float ta = (y - 0.5f - pad - b.y) / delta.y;
+            float tb = (y + 0.5f + pad - a.y) / delta.y;
+            if(ta > tb) std::swap(ta, tb);
+            t0 = std::max(t0, ta); t1 = std::min(t1, tb);
+            if(t0 > t1) continue;
+        }
+        float xa = std::min(delta.x * t0, delta.x * t1);
+        float xb = std::max(delta.x * t0, delta.x * t1);
+        float fx0 = std::floor(a.x + xa - 0.5f - pad), fx1 = std::ceil(b.x + xb + 0.5f + pad);
+        int x0 = (int)std::max(fx0, 0.0f), x1 = (int)std::min(fx1, (float)grid.W - 1);
+        for(int x=x0; x<=x1; ++x)
+            if(grid.wallAt(x, y)) f(tileAABB(x, y));
+    }
+}
+
+// shared slide solver; Statics provides
+//   near(lo, hi, f)          -> f(AABB) for every static that may touch [lo,hi]
+//   sweep(mover, delta)      -> earliest SweepHit (first in list order on ties)
+template<class Statics>
+inline float moveAndCollideWith(AABB& mover, glm::vec2 delta, const Statics& statics,
+                                glm::vec2* outNormal)
 {
+    PROF_ZONE("moveAndCollide");
     auto overlap2D = [](const AABB& a, const AABB& b, glm::vec2& pushOut){
         glm::vec2 aMin=a.center-a.half, aMax=a.center+a.half;
         glm::vec2 bMin=b.center-b.half, bMax=b.center+b.half;
@@ -78,12 +273,15 @@ inline float moveAndCollide(AABB& mover, glm::vec2 delta,
     // 0) depenetration (เผื่อเริ่มทับกันอยู่)
     for(int k=0;k<3;++k){
         bool any=false; glm::vec2 po;
-        for(const auto& s: statics){
-            if(overlap2D(mover, s, po)){
-                mover.center += po * 1.001f; // ดันออกนิดเดียว
-                any=true;
-            }
-        }
+        // one push moves the mover at most (its size + one tile) along an axis
+        glm::vec2 reach = mover.half * 2.0f + glm::vec2(1.0f);
+        statics.near(mover.center - mover.half - reach, mover.center + mover.half + reach,
+            [&](const AABB& s){
+                if(overlap2D(mover, s, po)){
+                    mover.center += po * 1.001f; // ดันออกนิดเดียว
+                    any=true;
+                }
+            });
         if(!any) break;
     }
 
@@ -91,11 +289,8 @@ inline float moveAndCollide(AABB& mover, glm::vec2 delta,
     glm::vec2 remain = delta;
 
     for(int iter=0; iter<4 && (std::abs(remain.x)+std::abs(remain.y))>1e-6f; ++iter){
-        float bestToi = 1.0f; glm::vec2 bestN{0,0};
-        for(const auto& s : statics){
-            SweepHit h = sweepAABB(mover, remain, s);
-            if(h.toi < bestToi){ bestToi=h.toi; bestN=h.normal; }
-        }
+        SweepHit best = statics.sweep(mover, remain);
+        float bestToi = best.toi; glm::vec2 bestN = best.normal;
 
         // เดินถึงจุดชน (หรือทั้งช่วงถ้าไม่ชน)
         mover.center += remain * bestToi;
@@ -128,3 +323,66 @@ inline float moveAndCollide(AABB& mover, glm::vec2 delta,
     if(outNormal) *outNormal = nAccum;
     return 0.0f; // (ไม่จำเป็นต้องใช้ค่านี้ในตอนนี้)
 }
+
+// move and collide vs list (static geometry) — brute force over every entry
+struct AABBListStatics {
+    const std::vector<AABB>& list;
+    template<class F> void near(glm::vec2, glm::vec2, F&& f) const { for(const auto& s: list) f(s); }
+    SweepHit sweep(const AABB& mover, glm::vec2 d) const {
+        SweepHit best{1.0f, {0,0}};
+        for(const auto& s: list){
+            SweepHit h = sweepAABB(mover, d, s);
+            if(h.toi < best.toi) best = h;
+        }
+        return best;
+    }
+};
+
+inline float moveAndCollide(AABB& mover, glm::vec2 delta,
+                            const std::vector<AABB>& statics,
+                            glm::vec2* outNormal=nullptr)
+{
+    return moveAndCollideWith(mover, delta, AABBListStatics{statics}, outNormal);
+}
+
+// move and collide vs prebuilt SoA colliders (batch kernel)
+struct AABBSoAStatics {
+    const AABBSoA& soa;
+    template<class F> void near(glm::vec2, glm::vec2, F&& f) const {
+        for(size_t i=0; i<soa.size(); ++i) f(soa.get(i));
+    }
+    SweepHit sweep(const AABB& mover, glm::vec2 d) const {
+        BatchHit h = sweepAABBBatch(mover, d, soa);
+        return { h.toi, h.normal };
+    }
+};
+
+inline float moveAndCollide(AABB& mover, glm::vec2 delta,
+                            const AABBSoA& statics,
+                            glm::vec2* outNormal=nullptr)
+{
+    return moveAndCollideWith(mover, delta, AABBSoAStatics{statics}, outNormal);
+}
+
+// move and collide vs tile grid (walls read straight from the level);
+// candidate tiles are gathered in list order and swept in one batch
+template<class TileGrid>
+struct TileGridStatics {
+    const TileGrid& grid;
+    template<class F> void near(glm::vec2 lo, glm::vec2 hi, F&& f) const { forEachWallTile(grid, lo, hi, f); }
+    SweepHit sweep(const AABB& mover, glm::vec2 d) const {
+        thread_local AABBSoA candidates;
+        candidates.clear();
+        forEachWallTileSwept(grid, mover, d, [&](const AABB& s){ candidates.push(s); });
+        BatchHit h = sweepAABBBatch(mover, d, candidates);
+        return { h.toi, h.normal };
+    }
+};
+
+template<class TileGrid>
+inline float moveAndCollide(AABB& mover, glm::vec2 delta,
+                            const TileGrid& grid,
+                            glm::vec2* outNormal=nullptr)
+{
+    return moveAndCollideWith(mover, delta, TileGridStatics<TileGrid>{grid}, outNormal);
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include "collision.h"   // sweep_simd lane helpers
+#include "grid.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Frustum planes from a view-projection matrix (Gribb/Hartmann), inside when
+// dot(plane.xyz, p) + plane.w >= 0. Planes are normalised so the AABB test
+// below works in world units.
+struct Frustum {
+    glm::vec4 planes[6];
+
+    static Frustum fromMatrix(const glm::mat4& m){
+        // rows of the column-major matrix
+        glm::vec4 r0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 r1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 r2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 r3(m[0][3], m[1][3], m[2][3], m[3][3]);
+        Frustum f;
+        f.planes[0] = r3 + r0;   // left
+        f.planes[1] = r3 - r0;   // right
+        f.planes[2] = r3 + r1;   // bottom
+        f.planes[3] = r3 - r1;   // top
+        f.planes[4] = r3 + r2;   // near
+        f.planes[5] = r3 - r2;   // far
+        for(auto& p : f.planes){
+            float len = std::sqrt(p.x*p.x + p.y*p.y + p.z*p.z);
+            if(len > 0.0f) p = p * (1.0f / len);
+        }
+        return f;
+    }
+};
+
+// world-space boxes as centre/half extents, SoA for the SIMD test
+struct BoundsSoA {
+    std::vector<float> cx, cy, cz, ex, ey, ez;
+    void clear(){ cx.clear(); cy.clear(); cz.clear(); ex.clear(); ey.clear(); ez.clear(); }
+    void push(glm::vec3 lo, glm::vec3 hi){
+        glm::vec3 c = (lo + hi) * 0.5f, e = (hi - lo) * 0.5f;
+        cx.push_back(c.x); cy.push_back(c.y); cz.push_back(c.z);
+        ex.push_back(e.x); ey.push_back(e.y); ez.push_back(e.z);
+    }
+    size_t size() const { return cx.size(); }
+};
+
+// one box against the six planes: outside if fully behind any plane
+inline bool boxInFrustum(const Frustum& f, const BoundsSoA& b, size_t i){
+    for(const auto& p : f.planes){
+        float d = p.x*b.cx[i] + p.y*b.cy[i] + p.z*b.cz[i] + p.w;
+        float r = std::abs(p.x)*b.ex[i] + std::abs(p.y)*b.ey[i] + std::abs(p.z)*b.ez[i];
+        if(d + r < 0.0f) return false;
+    }
+    return true;
+}
+
+// visible[i] = boxInFrustum for boxes [first, last), W boxes per step on
+// the sweep SIMD lanes; visible must already hold b.size() entries, so
+// disjoint ranges can run on different threads. Returns the visible count.
+inline size_t cullBoxes(const Frustum& f, const BoundsSoA& b, std::vector<uint8_t>& visible, size_t first, size_t last){
+    size_t begin = first, count = 0;
+#if defined(SOKOBAN_SWEEP_AVX) || defined(SOKOBAN_SWEEP_SSE)
+    using namespace sweep_simd;
+    const size_t nv = last - (last - first) % W;
+    const V zero = set1(0.0f), one = set1(1.0f);
+    for(size_t i=first; i<nv; i+=W){
+        V cx = load(&b.cx[i]), cy = load(&b.cy[i]), cz = load(&b.cz[i]);
+        V ex = load(&b.ex[i]), ey = load(&b.ey[i]), ez = load(&b.ez[i]);
+        V in = ge(one, zero);   // all lanes set
+        for(const auto& p : f.planes){
+            V d = add(add(mul(set1(p.x), cx), mul(set1(p.y), cy)), add(mul(set1(p.z), cz), set1(p.w)));
+            V r = add(add(mul(set1(std::abs(p.x)), ex), mul(set1(std::abs(p.y)), ey)), mul(set1(std::abs(p.z)), ez));
+            in = vand(in, ge(add(d, r), zero));
+        }
+        alignas(32) float lane[W];
+        store(lane, blend(zero, one, in));
+        for(int l=0; l<W; ++l){ visible[i+l] = lane[l] != 0.0f; count += visible[i+l]; }
+    }
+    begin = nv;
+#endif
+    for(size_t i=begin; i<last; ++i){ visible[i] = boxInFrustum(f, b, i); count += visible[i]; }
+    return count;
+}
+
+// every box; resizes visible
+inline size_t cullBoxes(const Frustum& f, const BoundsSoA& b, std::vector<uint8_t>& visible){
+    visible.resize(b.size());
+    return cullBoxes(f, b, visible, 0, b.size());
+}
+
+// Fixed-size square chunks of grid tiles with world bounds, rebuilt per level
+// (Simulation::loadCurrentLevel). Chunk (x, y) is index y*countX + x; tiles
+// are in world space at (x, ., y) with the unit cube around them.
+struct TileChunks {
+    static constexpr int kSize = 8;
+    int countX = 0, countY = 0;
+    BoundsSoA bounds;
+
+    void build(const Grid& g, float minY = -0.5f, float maxY = 1.5f){
+        countX = (g.W + kSize - 1) / kSize;
+        countY = (g.H + kSize - 1) / kSize;
+        bounds.clear();
+        for(int cy=0; cy<countY; ++cy)
+            for(int cx=0; cx<countX; ++cx){
+                int x0 = cx*kSize, y0 = cy*kSize;
+                int x1 = std::min(g.W, x0 + kSize) - 1, y1 = std::min(g.H, y0 + kSize) - 1;
+                bounds.push({ x0 - 0.5f, minY, y0 - 0.5f }, { x1 + 0.5f, maxY, y1 + 0.5f });
+            }
+    }
+    int size() const { return countX * countY; }
+    int chunkOf(int x, int y) const { return (y / kSize) * countX + (x / kSize); }
+};
@@ -0,0 +1,366 @@
+#include "deadlock.h"
+#include "profiler.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+
+namespace {
+
+constexpr glm::ivec2 kDirs[4] = { {1,0}, {-1,0}, {0,1}, {0,-1} };
+constexpr int kMaxFreezeDepth = 64;     // deeper crate chains count as not frozen
+
+} // namespace
+
+const char* DeadlockAnalyzer::kindName(Kind k){
+    switch(k){
+        case Kind::DeadSquare: return "dead square";
+        case Kind::Freeze:     return "frozen";
+        case Kind::Corral:     return "corral";
+        default:               return "none";
+    }
+}
+
+bool DeadlockAnalyzer::wall(glm::ivec2 p) const {
+    if(grid->isWall(p)) return true;
+    for(const auto& w : asWall) if(w == p) return true;
+    return false;
+}
+
+// bits of g spread towards bit 0 while p allows (p = cells that may take
+// the bit from their upper neighbour); Kogge-Stone occluded fill
+static inline uint64_t fillDown(uint64_t g, uint64_t p){
+    g |= p & (g >> 1);  p &= p >> 1;
+    g |= p & (g >> 2);  p &= p >> 2;
+    g |= p & (g >> 4);  p &= p >> 4;
+    g |= p & (g >> 8);  p &= p >> 8;
+    g |= p & (g >> 16); p &= p >> 16;
+    return g | (p & (g >> 32));
+}
+static inline uint64_t fillUp(uint64_t g, uint64_t p){
+    g |= p & (g << 1);  p &= p << 1;
+    g |= p & (g << 2);  p &= p << 2;
+    g |= p & (g << 4);  p &= p << 4;
+    g |= p & (g << 8);  p &= p << 8;
+    g |= p & (g << 16); p &= p << 16;
+    return g | (p & (g << 32));
+}
+
+void DeadlockAnalyzer::build(const Grid& g){
+    PROF_ZONE("DeadlockAnalyzer::build");
+    auto t0 = std::chrono::steady_clock::now();
+    grid = &g;
+    W = g.W; H = g.H;
+    const int S = g.walls.chunksX;              // words per row
+    stride = (size_t)S * 64;
+    const size_t words = (size_t)S * H;
+    live.assign(words, 0);
+    crate.assign(words, 0);
+    found.clear();
+
+    // open tiles, one row-major word per 64 tiles (the grid planes store
+    // each chunk row as one word, so this is a copy, not a per-tile scan)
+    std::vector<uint64_t> open(words);
+    const uint64_t* wl = g.walls.data();
+    const uint64_t* vd = g.voids.data();
+    for(int y=0; y<H; ++y)
+        for(int c=0; c<S; ++c){
+            size_t wi = g.walls.wordIndex(c * 64, y);
+            uint64_t m = W - c * 64 >= 64 ? ~0ull : (1ull << (W - c * 64)) - 1;
+            open[(size_t)y * S + c] = ~(wl[wi] | vd[wi]) & m;
+        }
+
+    // reverse pull flood from every goal: a crate at q came from q-d, with
+    // the player standing at q-2d. Same rule as the solver's goalDist, run
+    // on 64 tiles at a time: a word is queued whenever it gains live bits.
+    std::vector<uint8_t> queued(words, 0);
+    std::vector<uint32_t> queue;
+    auto gain = [&](size_t w, uint64_t bits){
+        bits &= ~live[w];
+        if(!bits) return;
+        live[w] |= bits;
+        if(!queued[w]){ queued[w] = 1; queue.push_back((uint32_t)w); }
+    };
+    for(const auto& p : g.goals) if(inside(p)) gain((size_t)p.y * S + (p.x >> 6), 1ull << (p.x & 63));
+    for(size_t head = 0; head < queue.size(); ++head){
+        const size_t w = queue[head];
+        queued[w] = 0;
+        const int y = (int)(w / S), c = (int)(w % S);
+        const uint64_t o = open[w];
+        const uint64_t oPrev = c > 0 ? open[w - 1] : 0, oNext = c + 1 < S ? open[w + 1] : 0;
+        // along the row: x takes from x+1 when x-1 is open, from x-1 when x+1 is
+        const uint64_t fromRight = o & ((o << 1) | (oPrev >> 63));
+        const uint64_t fromLeft  = o & ((o >> 1) | (oNext << 63));
+        uint64_t l = live[w], was;
+        do {
+            was = l;
+            l = fillDown(l, fromRight);
+            l = fillUp(l, fromLeft);
+        } while(l != was);
+        live[w] = l;
+        if(c > 0 && (l & 1))         gain(w - 1, oPrev & (oPrev << 1) & (1ull << 63));
+        if(c + 1 < S && (l >> 63))   gain(w + 1, oNext & (oNext >> 1) & 1ull);
+        // across rows: row y-1 takes from y when y-2 is open, y+1 when y+2 is
+        if(y >= 2)     gain(w - S, l & open[w - S] & open[w - 2 * (size_t)S]);
+        if(y + 2 < H)  gain(w + S, l & open[w + S] & open[w + 2 * (size_t)S]);
+    }
+
+    size_t floor = 0, liveCount = 0;
+    for(size_t w = 0; w < words; ++w){ floor += std::popcount(open[w]); liveCount += std::popcount(live[w]); }
+    deadCount = floor - liveCount;
+    stats = {};
+    stats.buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+void DeadlockAnalyzer::reset(const std::vector<glm::ivec2>& crateCells){
+    std::fill(crate.begin(), crate.end(), 0);
+    for(const auto& c : crateCells) if(inside(c)) set(crate, idx(c), true);
+    found.clear();
+}
+
+void DeadlockAnalyzer::moveCrate(glm::ivec2 from, glm::ivec2 to, glm::ivec2 player){
+    if(!grid) return;
+    auto t0 = std::chrono::steady_clock::now();
+    if(inside(from)) set(crate, idx(from), false);
+    if(inside(to))   set(crate, idx(to), true);
+
+    // earlier findings this move could have undone: decide them again
+    auto touches = [&](const Deadlock& d, glm::ivec2 p){
+        return p.x >= d.lo.x && p.y >= d.lo.y && p.x <= d.hi.x && p.y <= d.hi.y;
+    };
+    bool known = false;
+    for(size_t i = 0; i < found.size();){
+        Deadlock& d = found[i];
+        if(touches(d, from) || touches(d, to)){
+            d.kind = hasCrate(d.cell) ? check(d.cell, player) : Kind::None;
+            d.lo = seenLo; d.hi = seenHi;
+        }
+        if(d.kind == Kind::None){ found[i] = found.back(); found.pop_back(); continue; }
+        known |= d.cell == to;
+        ++i;
+    }
+    if(!known && inside(to)){
+        Kind k = check(to, player);
+        if(k != Kind::None) found.push_back({ k, to, seenLo, seenHi });
+    }
+
+    stats.checks++;
+    stats.lastUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    stats.maxUs = std::max(stats.maxUs, stats.lastUs);
+}
+
+// seenLo/seenHi end up around every cell the verdict depended on
+DeadlockAnalyzer::Kind DeadlockAnalyzer::check(glm::ivec2 c, glm::ivec2 player){
+    seenLo = seenHi = c;
+    if(!grid->isGoal(c) && isDead(c)) return Kind::DeadSquare;
+
+    asWall.clear();
+    frozenGroup.clear();
+    bool f = frozen(c);
+    for(const auto& w : asWall){ seenLo = glm::min(seenLo, w - 1); seenHi = glm::max(seenHi, w + 1); }
+    if(f) for(const auto& g : frozenGroup) if(!grid->isGoal(g)) return Kind::Freeze;
+    asWall.clear();
+
+    if(corralDeadlock(c, player)) return Kind::Corral;
+    return Kind::None;
+}
+
+// A crate is frozen when it cannot move along either axis. While its
+// neighbours are checked it counts as a wall, so two crates side by side
+// against a wall block each other without recursing forever.
+bool DeadlockAnalyzer::frozen(glm::ivec2 c){
+    if((int)asWall.size() >= kMaxFreezeDepth) return false;
+    asWall.push_back(c);
+    bool f = blockedOn(c, {1,0}) && blockedOn(c, {0,1});
+    if(f) frozenGroup.push_back(c);
+    return f;
+}
+
+bool DeadlockAnalyzer::blockedOn(glm::ivec2 c, glm::ivec2 axis){
+    glm::ivec2 a = c - axis, b = c + axis;
+    if(wall(a) || wall(b)) return true;
+    if(isDead(a) && isDead(b)) return true;     // either push ends on a dead square
+    if(hasCrate(a) && frozen(a)) return true;
+    if(hasCrate(b) && frozen(b)) return true;
+    return false;
+}
+
+// Player reach inside the corral window: stamps m with every open cell
+// reachable from the seed (and from the open border when asked) and returns
+// the smallest cell of the seed's own component, the player part of a
+// state (ww * wh when there is no seed). Crates are tile bit 3.
+int DeadlockAnalyzer::reach(uint32_t* m, int seed, bool border, int ww, int wh){
+    if(++stamp == 0){ std::fill(mark.begin(), mark.end(), 0); stamp = 1; }
+    fifo.clear();
+    auto open = [&](int i){
+        if(tile[i] & 9 || m[i] == stamp) return;
+        m[i] = stamp;
+        fifo.push_back(i);
+    };
+    auto flood = [&](size_t h){
+        for(; h < fifo.size(); ++h){
+            int i = fifo[h], x = i % ww, y = i / ww;
+            if(x > 0)      open(i - 1);
+            if(x < ww - 1) open(i + 1);
+            if(y > 0)      open(i - ww);
+            if(y < wh - 1) open(i + ww);
+        }
+    };
+    int minCell = ww * wh;
+    if(seed >= 0 && seed < ww * wh){
+        open(seed);
+        flood(0);
+        for(int i : fifo) minCell = std::min(minCell, i);
+    }
+    if(border){
+        size_t h = fifo.size();
+        for(int x = 0; x < ww; ++x){ open(x); open((wh - 1) * ww + x); }
+        for(int y = 1; y < wh - 1; ++y){ open(y * ww); open(y * ww + ww - 1); }
+        flood(h);
+    }
+    return minCell;
+}
+
+// adds a search state unless it was seen before; false = seen
+bool DeadlockAnalyzer::visit(const uint16_t* s, int stride){
+    uint32_t h = 2166136261u;
+    for(int k = 0; k < stride; ++k){ h ^= s[k]; h *= 16777619u; }
+    const uint32_t mask = (uint32_t)table.size() - 1;
+    for(uint32_t slot = h & mask;; slot = (slot + 1) & mask){
+        uint32_t e = table[slot];
+        if(e == UINT32_MAX){
+            table[slot] = (uint32_t)(states.size() / stride);
+            states.insert(states.end(), s, s + stride);
+            return true;
+        }
+        if(std::equal(s, s + stride, &states[(size_t)e * stride])) return false;
+    }
+}
+
+// A corral is floor the player cannot reach, fenced by walls and crates.
+// The fence crates are searched on their own: every other crate is removed
+// and the player may also enter from anywhere on the window border (the
+// rest of the map lies beyond it). Both only add moves, so when even then
+// no push sequence lets the player in, gets a fence crate out of the window
+// or puts all of them on goals, the real level is stuck too.
+bool DeadlockAnalyzer::corralDeadlock(glm::ivec2 c, glm::ivec2 player){
+    // the rounded player centre can sit on a crate mid-push; the next move
+    // checks again
+    if(grid->isWall(player) || hasCrate(player)) return false;
+
+    // 1) a small region next to c that the player cannot walk into. Cells
+    // flooded from one side stay marked, so a side already found open to
+    // the player is not flooded again.
+    constexpr int R = kMaxCorralCells, side = 2 * R + 1;
+    nearBits.assign((side * side + 63) / 64, 0);
+    auto seen = [&](glm::ivec2 q){
+        glm::ivec2 l = q - c + R;
+        size_t i = (size_t)l.y * side + l.x;
+        bool was = (nearBits[i >> 6] >> (i & 63)) & 1;
+        nearBits[i >> 6] |= 1ull << (i & 63);
+        return was;
+    };
+    region.clear();
+    size_t first = 0;
+    bool closed = false;
+    for(const auto& d : kDirs){
+        glm::ivec2 s = c + d;
+        if(grid->isWall(s) || hasCrate(s) || s == player || seen(s)) continue;
+        first = region.size();
+        region.push_back(s);
+        bool open = false;
+        for(size_t i = first; i < region.size() && !open; ++i)
+            for(const auto& e : kDirs){
+                glm::ivec2 q = region[i] + e;
+                if(grid->isWall(q) || hasCrate(q)) continue;
+                if(q == player || (int)(region.size() - first) >= kMaxCorralCells){ open = true; break; }
+                if(!seen(q)) region.push_back(q);
+            }
+        if(!open){ closed = true; break; }
+    }
+    for(const auto& r : region){ seenLo = glm::min(seenLo, r - 1); seenHi = glm::max(seenHi, r + 1); }
+    if(!closed) return false;
+    region.erase(region.begin(), region.begin() + first);
+
+    // 2) the crates fencing it, at least one of them off its goal
+    fence.clear();
+    for(const auto& r : region)
+        for(const auto& d : kDirs){
+            glm::ivec2 q = r + d;
+            if(hasCrate(q) && std::find(fence.begin(), fence.end(), q) == fence.end()) fence.push_back(q);
+        }
+    if(fence.empty() || (int)fence.size() > kMaxCorralCrates) return false;
+    bool offGoal = false;
+    for(const auto& f : fence) offGoal |= !grid->isGoal(f);
+    if(!offGoal) return false;
+
+    // 3) search window: corral and fence bounds plus a margin, clipped.
+    // tile bits: 0 wall, 1 goal, 2 dead, 3 crate of the layout being flooded
+    glm::ivec2 lo = fence[0], hi = fence[0];
+    for(const auto& r : region){ lo = glm::min(lo, r); hi = glm::max(hi, r); }
+    for(const auto& f : fence){ lo = glm::min(lo, f); hi = glm::max(hi, f); }
+    lo = glm::max(lo - kWindowMargin, glm::ivec2(0));
+    hi = glm::min(hi + kWindowMargin, glm::ivec2(W - 1, H - 1));
+    seenLo = glm::min(seenLo, lo); seenHi = glm::max(seenHi, hi);
+    const int ww = hi.x - lo.x + 1, wh = hi.y - lo.y + 1, cells = ww * wh;
+    auto local = [&](glm::ivec2 p){ return (p.y - lo.y) * ww + (p.x - lo.x); };
+    tile.resize(cells);
+    for(int i = 0; i < cells; ++i){
+        glm::ivec2 p(lo.x + i % ww, lo.y + i / ww);
+        bool goal = grid->isGoal(p);
+        tile[i] = (uint8_t)(grid->isWall(p) | goal << 1 | (!goal && isDead(p)) << 2);
+    }
+    mark.assign((size_t)cells * 2, 0);     // [0, cells) node being expanded, then its children
+    stamp = 0;
+    uint32_t* here = mark.data();
+    uint32_t* child = mark.data() + cells;
+
+    // 4) breadth-first over pushes; state = sorted crate cells + player
+    const int nc = (int)fence.size(), stride = nc + 1;
+    states.clear();
+    table.assign(4096, UINT32_MAX);
+    uint16_t cur[kMaxCorralCrates + 1], next[kMaxCorralCrates + 1];
+    for(int k = 0; k < nc; ++k) cur[k] = (uint16_t)local(fence[k]);
+    std::sort(cur, cur + nc);
+    const bool playerIn = player.x >= lo.x && player.y >= lo.y && player.x <= hi.x && player.y <= hi.y;
+    for(int k = 0; k < nc; ++k) tile[cur[k]] |= 8;
+    cur[nc] = (uint16_t)reach(child, playerIn ? local(player) : -1, false, ww, wh);
+    for(int k = 0; k < nc; ++k) tile[cur[k]] &= ~8;
+    visit(cur, stride);
+
+    stats.corralSearches++;
+    for(size_t node = 0; node * stride < states.size(); ++node){
+        if((int)node >= kMaxCorralNodes) return false;     // too big to tell
+        stats.corralNodes++;
+        std::copy_n(&states[node * stride], stride, cur);
+        for(int k = 0; k < nc; ++k) tile[cur[k]] |= 8;
+        reach(here, cur[nc], true, ww, wh);
+        const uint32_t hereStamp = stamp;
+        bool done = false;
+        for(int k = 0; k < nc && !done; ++k){
+            const int at = cur[k], x = at % ww, y = at / ww;
+            for(const auto& d : kDirs){
+                const int fx = x - d.x, fy = y - d.y, tx = x + d.x, ty = y + d.y;
+                if(fx < 0 || fy < 0 || fx >= ww || fy >= wh || tx < 0 || ty < 0 || tx >= ww || ty >= wh) continue;
+                const int to = ty * ww + tx;
+                if(here[fy * ww + fx] != hereStamp || tile[to] & 13) continue;
+                if(tx == 0 || ty == 0 || tx == ww - 1 || ty == wh - 1){ done = true; break; }   // out of the corral
+                std::copy_n(cur, nc, next);
+                next[k] = (uint16_t)to;
+                std::sort(next, next + nc);
+                bool solved = true;
+                for(int m = 0; m < nc; ++m) solved &= (tile[next[m]] & 2) != 0;
+                if(solved){ done = true; break; }
+                if(states.size() / stride >= table.size() / 2){ done = true; break; }  // too big to tell
+                tile[at] &= ~8; tile[to] |= 8;
+                next[nc] = (uint16_t)reach(child, at, false, ww, wh);
+                tile[to] &= ~8; tile[at] |= 8;
+                for(const auto& r : region) done |= child[local(r)] == stamp;
+                if(done) break;                             // the player gets into the corral
+                visit(next, stride);
+            }
+        }
+        for(int k = 0; k < nc; ++k) tile[cur[k]] &= ~8;
+        if(done) return false;
+    }
+    return true;                                            // no push sequence gets out
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "grid.h"
+
+// Runtime deadlock detection for the level being played.
+//
+// build() marks dead squares once per level: a reverse-pull flood from every
+// goal (a crate at q can have come from q-d with the player at q-2d); cells
+// it never reaches can never get a crate to a goal. After that, every time a
+// crate enters a new cell the analyser looks only at that neighbourhood:
+//
+//   dead square  the crate sits on a dead, non-goal cell
+//   freeze       the crate cannot move on either axis (walls, dead squares
+//                on both sides, or other frozen crates) and the frozen
+//                group holds a crate off its goal
+//   corral       the crate closes a small area the player cannot enter, and
+//                a bounded push search over the crates around it (all other
+//                crates removed, the player free outside the area) finds no
+//                way to put them all on goals without a crate escaping
+//
+// Every rule only ever errs towards "not deadlocked": a corral search that
+// hits its node cap, or a crate that leaves the search window, counts as
+// solvable. Deadlocks found stay reported until a later move inside the
+// area they were decided on (undo, reset) makes them stop holding.
+class DeadlockAnalyzer {
+public:
+    enum class Kind : uint8_t { None, DeadSquare, Freeze, Corral };
+    struct Deadlock {
+        Kind kind = Kind::None;
+        glm::ivec2 cell{0};             // the crate that caused it
+        glm::ivec2 lo{0}, hi{0};        // cells the verdict looked at; moves elsewhere keep it
+    };
+    struct Stats {
+        uint64_t checks = 0;
+        uint64_t corralSearches = 0, corralNodes = 0;
+        double lastUs = 0.0, maxUs = 0.0;   // moveCrate wall time
+        double buildMs = 0.0;
+    };
+
+    // corral search bounds: bigger areas or crowds are not analysed
+    static constexpr int kMaxCorralCells  = 48;
+    static constexpr int kMaxCorralCrates = 6;
+    static constexpr int kMaxCorralNodes  = 256;
+    static constexpr int kWindowMargin    = 3;
+
+    void build(const Grid& g);
+    // the grid build() read has moved (levels prepared ahead are swapped in)
+    void rebind(const Grid& g){ grid = &g; }
+    // crate occupancy from scratch; clears reported deadlocks
+    void reset(const std::vector<glm::ivec2>& crateCells);
+    // a crate went from one cell to another; re-checks the reported
+    // deadlocks and the crate's new neighbourhood
+    void moveCrate(glm::ivec2 from, glm::ivec2 to, glm::ivec2 player);
+
+    bool isDead(glm::ivec2 p) const { return inside(p) && !test(live, idx(p)); }
+    size_t deadSquares() const { return deadCount; }
+    bool deadlocked() const { return !found.empty(); }
+    const std::vector<Deadlock>& deadlocks() const { return found; }
+    static const char* kindName(Kind k);
+
+    Stats stats;
+
+private:
+    const Grid* grid = nullptr;
+    int W = 0, H = 0;
+    size_t stride = 0;                  // bits per row (whole words)
+    std::vector<uint64_t> live;         // bit per tile: a crate here can still reach a goal
+    std::vector<uint64_t> crate;        // bit per tile: crate cell
+    size_t deadCount = 0;
+    std::vector<Deadlock> found;
+
+    // scratch, reused across checks
+    std::vector<glm::ivec2> asWall;     // freeze recursion: crates treated as walls
+    std::vector<glm::ivec2> frozenGroup;
+    std::vector<glm::ivec2> region, fence;
+    std::vector<uint64_t> nearBits;     // corral flood: bit per cell around the moved crate
+    std::vector<int32_t> fifo;
+    std::vector<uint8_t> tile;          // corral window: bit 0 wall, 1 goal, 2 dead, 3 crate
+    std::vector<uint32_t> mark;         // corral window: player reach stamps (node, child)
+    std::vector<uint16_t> states;       // corral search: crate cells + player, per node
+    std::vector<uint32_t> table;        // corral search: open addressing into states
+    uint32_t stamp = 0;
+    glm::ivec2 seenLo{0}, seenHi{0};    // bounds of what the last check() read
+
+    bool inside(glm::ivec2 p) const { return p.x >= 0 && p.y >= 0 && p.x < W && p.y < H; }
+    size_t idx(glm::ivec2 p) const { return (size_t)p.y * stride + p.x; }
+    static bool test(const std::vector<uint64_t>& b, size_t i){ return (b[i >> 6] >> (i & 63)) & 1; }
+    static void set(std::vector<uint64_t>& b, size_t i, bool v){
+        if(v) b[i >> 6] |= 1ull << (i & 63); else b[i >> 6] &= ~(1ull << (i & 63));
+    }
+    bool wall(glm::ivec2 p) const;
+    bool hasCrate(glm::ivec2 p) const { return inside(p) && test(crate, idx(p)); }
+
+    Kind check(glm::ivec2 c, glm::ivec2 player);
+    bool frozen(glm::ivec2 c);
+    bool blockedOn(glm::ivec2 c, glm::ivec2 axis);
+    bool corralDeadlock(glm::ivec2 c, glm::ivec2 player);
+    int reach(uint32_t* m, int seed, bool border, int ww, int wh);
+    bool visit(const uint16_t* state, int stride);
+};
@@ -0,0 +1,109 @@
+#pragma once
+#include "collision.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+// Stable reference to an entity: index into the handle table plus the
+// generation it was issued with, so a handle to a destroyed entity stays
+// detectably stale after its index is reused.
+struct EntityId {
+    uint32_t index = ~0u;
+    uint32_t gen = 0;
+    bool operator==(const EntityId&) const = default;
+};
+
+// Entities as structure-of-arrays: one dense vector per component, all in
+// the same slot order, so each system streams only the arrays it reads
+// (collision: collider; interpolation: collider + prev -> world; drawing:
+// world + scale + color). Slots are 0..size()-1 with no holes; destroy()
+// moves the last entity into the freed slot, which is why anything keyed
+// by slot (e.g. a BodyHash) must be told about the move.
+struct EntityStore {
+    static constexpr uint32_t kNone = ~0u;
+
+    // ---- components, indexed by slot ----
+    std::vector<AABB>      collider;    // centre + half extents, grid units
+    std::vector<glm::vec2> prev;        // collider centre at the previous tick
+    std::vector<glm::vec3> world;       // interpolated render position (x, 0, y)
+    std::vector<float>     scale;
+    std::vector<glm::vec3> color;       // render tint
+
+    size_t size() const { return collider.size(); }
+    bool empty() const { return collider.empty(); }
+
+    void clear(){
+        collider.clear(); prev.clear(); world.clear(); scale.clear(); color.clear();
+        owner.clear();
+        // bump live generations so handles from the previous contents go stale
+        freeList.clear();
+        for(uint32_t i=(uint32_t)slotOf.size(); i-- > 0; ){
+            if(slotOf[i] != kNone){ slotOf[i] = kNone; gen[i]++; }
+            freeList.push_back(i);
+        }
+    }
+
+    void reserve(size_t n){
+        collider.reserve(n); prev.reserve(n); world.reserve(n); scale.reserve(n); color.reserve(n);
+        owner.reserve(n);
+    }
+
+    EntityId create(const AABB& box, glm::vec3 tint, float s = 1.0f){
+        uint32_t idx;
+        if(!freeList.empty()){ idx = freeList.back(); freeList.pop_back(); }
+        else { idx = (uint32_t)slotOf.size(); slotOf.push_back(kNone); gen.push_back(0); }
+        slotOf[idx] = (uint32_t)collider.size();
+        owner.push_back(idx);
+        collider.push_back(box);
+        prev.push_back(box.center);
+        world.push_back(glm::vec3(box.center.x, 0, box.center.y));
+        scale.push_back(s);
+        color.push_back(tint);
+        return { idx, gen[idx] };
+    }
+
+    // swap-remove; returns the slot the last entity moved into, or kNone
+    // when nothing moved (the removed entity was last, or id was stale)
+    uint32_t destroy(EntityId id){
+        if(!alive(id)) return kNone;
+        uint32_t s = slotOf[id.index], last = (uint32_t)size() - 1;
+        if(s != last){
+            collider[s] = collider[last]; prev[s] = prev[last];
+            world[s] = world[last]; scale[s] = scale[last]; color[s] = color[last];
+            owner[s] = owner[last];
+            slotOf[owner[s]] = s;
+        }
+        collider.pop_back(); prev.pop_back(); world.pop_back(); scale.pop_back(); color.pop_back();
+        owner.pop_back();
+        slotOf[id.index] = kNone;
+        gen[id.index]++;
+        freeList.push_back(id.index);
+        return s != last ? s : kNone;
+    }
+
+    bool alive(EntityId id) const {
+        return id.index < slotOf.size() && gen[id.index] == id.gen && slotOf[id.index] != kNone;
+    }
+    // dense slot of a live entity
+    uint32_t slot(EntityId id) const { return slotOf[id.index]; }
+    EntityId idAt(uint32_t s) const { return { owner[s], gen[owner[s]] }; }
+
+    // start of a tick: remember where every collider was
+    void snapshot(){
+        for(size_t i=0; i<collider.size(); ++i) prev[i] = collider[i].center;
+    }
+    // world = lerp(previous tick, current tick, alpha), slots [first, last)
+    void interpolate(float alpha, size_t first, size_t last){
+        for(size_t i=first; i<last; ++i){
+            glm::vec2 p = glm::mix(prev[i], collider[i].center, alpha);
+            world[i] = glm::vec3(p.x, 0, p.y);
+        }
+    }
+    void interpolate(float alpha){ interpolate(alpha, 0, size()); }
+
+private:
+    std::vector<uint32_t> slotOf;       // handle index -> slot (kNone when free)
+    std::vector<uint32_t> gen;          // handle index -> current generation
+    std::vector<uint32_t> owner;        // slot -> handle index
+    std::vector<uint32_t> freeList;     // handle indices ready for reuse
+};
@@ -0,0 +1,98 @@
+#pragma once
+// GL timer queries around draw passes, reported on the profiler's GPU track.
+// Only active with SOKOBAN_PROFILE and SOKOBAN_PROFILE_GPU; otherwise
+// PROF_GPU_* expand to nothing.
+//
+//   PROF_GPU_TIMERS(var)         declares the query pool
+//   PROF_GPU_FRAME(timers)       start of a frame: collects finished queries
+//   PROF_GPU_ZONE(timers, name)  scoped GL_TIME_ELAPSED query (no nesting)
+//   PROF_GPU_DESTROY(timers)     frees the queries (before the context goes)
+//
+// Results are read kFrames later so the CPU never waits on the GPU. Each pass
+// is placed at the CPU time it was submitted; only its duration is measured.
+
+#include "profiler.h"
+
+#if defined(SOKOBAN_PROFILE) && defined(SOKOBAN_PROFILE_GPU)
+#include <glad/glad.h>
+#include <vector>
+
+namespace prof {
+
+class GpuTimers {
+public:
+    static constexpr int kFrames = 4;          // frames in flight
+    static constexpr int kPerFrame = 16;       // passes per frame
+
+    void init(){
+        slots.resize(kFrames * kPerFrame);
+        std::vector<GLuint> ids(slots.size());
+        glGenQueries((GLsizei)ids.size(), ids.data());
+        for(size_t i=0; i<slots.size(); ++i) slots[i].query = ids[i];
+    }
+    void destroy(){
+        for(auto& s : slots) glDeleteQueries(1, &s.query);
+        slots.clear();
+    }
+
+    // results of the frame that used this ring slot kFrames ago
+    void beginFrame(){
+        if(slots.empty()) init();
+        frame = (frame + 1) % kFrames;
+        used = 0;
+        for(int i=0; i<kPerFrame; ++i){
+            Slot& s = slots[frame * kPerFrame + i];
+            if(!s.pending) continue;
+            GLint ready = 0;
+            glGetQueryObjectiv(s.query, GL_QUERY_RESULT_AVAILABLE, &ready);
+            if(ready){
+                GLuint64 ns = 0;
+                glGetQueryObjectui64v(s.query, GL_QUERY_RESULT, &ns);
+                Session::get().gpuEvent(s.name, s.cpuBeginNs, ns);
+            }
+            s.pending = false;    // not ready after kFrames: dropped, slot reused
+        }
+    }
+    // -1 when the frame is out of slots
+    int begin(const char* name){
+        if(slots.empty() || used >= kPerFrame) return -1;
+        int i = frame * kPerFrame + used++;
+        Slot& s = slots[i];
+        s.name = name; s.cpuBeginNs = nowNs(); s.pending = true;
+        glBeginQuery(GL_TIME_ELAPSED, s.query);
+        return i;
+    }
+    void end(int i){ if(i >= 0) glEndQuery(GL_TIME_ELAPSED); }
+
+private:
+    struct Slot {
+        GLuint query = 0;
+        const char* name = nullptr;
+        uint64_t cpuBeginNs = 0;
+        bool pending = false;
+    };
+    std::vector<Slot> slots;
+    int frame = 0, used = 0;
+};
+
+struct GpuZone {
+    GpuTimers& timers;
+    int slot;
+    GpuZone(GpuTimers& t, const char* name) : timers(t), slot(t.begin(name)) {}
+    ~GpuZone(){ timers.end(slot); }
+    GpuZone(const GpuZone&) = delete;
+    GpuZone& operator=(const GpuZone&) = delete;
+};
+
+} // namespace prof
+
+#define PROF_GPU_TIMERS(var)         ::prof::GpuTimers var
+#define PROF_GPU_FRAME(timers)       (timers).beginFrame()
+#define PROF_GPU_ZONE(timers, name)  ::prof::GpuZone PROF_CAT(profGpuZone_, __LINE__)(timers, name)
+#define PROF_GPU_DESTROY(timers)     (timers).destroy()
+#else
+#define PROF_GPU_TIMERS(var)         static_assert(true, "")
+#define PROF_GPU_FRAME(timers)       ((void)0)
+#define PROF_GPU_ZONE(timers, name)  ((void)0)
+#define PROF_GPU_DESTROY(timers)     ((void)0)
+#endif
@@ -0,0 +1,296 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "level_collection.h"
+#include "level_file.h"
+#include "mapped_file.h"
+
+struct Cell { enum T {Floor, Wall, Goal} type=Floor; };
+
+// one bit per tile in 64x64 chunks (grid coordinates, y up): chunk
+// (x>>6, y>>6) is 64 consecutive words, one per chunk row, bit = x & 63.
+// Storage is owned, or a read-only view into a mapped level file.
+struct BitPlane {
+    static constexpr int kChunkShift = 6, kChunk = 1 << kChunkShift;
+    int W=0, H=0, chunksX=0, chunksY=0;
+    std::vector<uint64_t> words;        // owned storage (empty for a view)
+    const uint64_t* view = nullptr;
+
+    static size_t wordsFor(int w, int h){
+        return (size_t)((w + kChunk - 1) >> kChunkShift) * ((h + kChunk - 1) >> kChunkShift) * kChunk;
+    }
+    void shape(int w, int h){ W=w; H=h; chunksX=(w + kChunk - 1) >> kChunkShift; chunksY=(h + kChunk - 1) >> kChunkShift; }
+    void resize(int w, int h){ shape(w, h); view=nullptr; words.assign(wordsFor(w, h), 0); }
+    void attach(int w, int h, const uint64_t* mapped){ shape(w, h); words.clear(); words.shrink_to_fit(); view=mapped; }
+
+    const uint64_t* data() const { return view ? view : words.data(); }
+    size_t wordCount() const { return (size_t)chunksX * chunksY * kChunk; }
+    size_t wordIndex(int x, int y) const {
+        return ((size_t)(y >> kChunkShift) * chunksX + (x >> kChunkShift)) * kChunk + (y & (kChunk-1));
+    }
+    bool test(int x, int y) const { return (data()[wordIndex(x,y)] >> (x & 63)) & 1; }
+    // owned planes only
+    void set(int x, int y)   { words[wordIndex(x,y)] |=  (1ull << (x & 63)); }
+    void reset(int x, int y) { words[wordIndex(x,y)] &= ~(1ull << (x & 63)); }
+    size_t count() const { size_t n=0; const uint64_t* d=data(); for(size_t i=0;i<wordCount();++i) n += std::popcount(d[i]); return n; }
+};
+
+struct Grid {
+    int W=0, H=0;
+    glm::ivec2 player{1,1};
+    std::vector<glm::ivec2> boxes;
+    std::vector<glm::ivec2> goals;
+
+    BitPlane walls;                 // '#'
+    BitPlane voids;                 // past the end of a short row (walls for isWall, open for wallAt)
+    BitPlane goalBits;              // '.'
+    BitPlane boxBits;               // current box cells
+    // per tile: index into boxes, valid only where boxBits is set (left
+    // uninitialised so a level switch never touches every tile)
+    std::unique_ptr<int32_t[]> boxIndex;
+    size_t goalsCovered = 0;        // goal tiles with a box on them
+
+    // .sokb (level_file.h) when the magic matches, otherwise the text format;
+    // collection level specs ("pack.xsb#12", level_collection.h) index the
+    // collection and decode that one level
+    bool load(const std::string& path){
+        std::string file, which;
+        if(LevelCollection::splitSpec(path, file, which)){
+            LevelCollection c;
+            if(!c.open(file)) return false;
+            long i = c.find(which);
+            return i >= 0 && load(c, (size_t)i);
+        }
+        MappedFile f(path);
+        if(!f.isOpen()) return false;
+        if(level_file::isLevelFile(f)) return loadBinary(std::move(f));
+        mapped.close();
+        return loadText((const char*)f.data(), f.size());
+    }
+
+    // text: one row per line, read from the mapping in two passes (size, fill)
+    bool loadText(const char* text, size_t len){
+        const char* end = text + len;
+        int rows = 0, width = 0;
+        for(const char* p = text; p < end; ++rows){
+            const char* nl = std::find(p, end, '\n');
+            int n = (int)(nl - p);
+            if(n > 0 && p[n-1] == '\r') --n;
+            width = std::max(width, n);
+            p = nl < end ? nl + 1 : end;
+        }
+        H = rows; W = width;
+
+        walls.resize(W, H); voids.resize(W, H); goalBits.resize(W, H);
+        resetBoxes();
+        goals.clear();
+        const char* p = text;
+        for(int ry=0; ry<H; ++ry){
+            const char* nl = std::find(p, end, '\n');
+            int n = (int)(nl - p);
+            if(n > 0 && p[n-1] == '\r') --n;
+            int y = H-1-ry;                     // flip once here; queries use grid y directly
+            for(int x=0; x<n; ++x){
+                char c = p[x];
+                if(c=='#') walls.set(x, y);
+                if(c=='P') player = {x, y};
+                if(c=='B') addBox({x, y});
+                if(c=='.'){ goalBits.set(x, y); goals.push_back({x, y}); }
+            }
+            for(int x=n; x<W; ++x) voids.set(x, y);
+            p = nl < end ? nl + 1 : end;
+        }
+        goalsCovered = 0;
+        for(auto& b : boxes) goalsCovered += goalBits.test(b.x, b.y);
+        return true;
+    }
+
+    // one level of an indexed collection
+    bool load(const LevelCollection& c, size_t i){
+        if(i >= c.size()) return false;
+        std::string_view b = c.board(i);
+        mapped.close();
+        return loadSok(b.data(), b.size());
+    }
+
+    // standard notation (# @ + $ * . and space/-/_ floor), run lengths and
+    // '|' row breaks; same two passes as loadText. Floor before a row's first
+    // wall is outside the level and becomes void like a short row's tail.
+    bool loadSok(const char* text, size_t len){
+        const char* end = text + len;
+        while(end > text && (end[-1] == '\n' || end[-1] == '\r')) --end;
+        int rows = 0, width = 0;
+        scanSok(text, end, [](int, char){}, [&](int n){ width = std::max(width, n); ++rows; });
+        H = rows; W = width;
+
+        walls.resize(W, H); voids.resize(W, H); goalBits.resize(W, H);
+        resetBoxes();
+        goals.clear();
+        int ry = 0;
+        bool outside = true;
+        scanSok(text, end, [&](int x, char c){
+            int y = H-1-ry;
+            if(outside && (c==' ' || c=='-' || c=='_')){ voids.set(x, y); return; }
+            outside = false;
+            if(c=='#') walls.set(x, y);
+            if(c=='@' || c=='+') player = {x, y};
+            if(c=='$' || c=='*') addBox({x, y});
+            if(c=='.' || c=='+' || c=='*'){ goalBits.set(x, y); goals.push_back({x, y}); }
+        }, [&](int n){
+            for(int x=n; x<W; ++x) voids.set(x, H-1-ry);
+            ++ry;
+            outside = true;
+        });
+        goalsCovered = 0;
+        for(auto& b : boxes) goalsCovered += goalBits.test(b.x, b.y);
+        return true;
+    }
+
+    // binary: planes stay in the mapping, only the entity lists are copied
+    bool loadBinary(MappedFile&& f){
+        const level_file::Header* h = level_file::validate(f, BitPlane::kChunkShift);
+        if(!h) return false;
+        mapped = std::move(f);
+        const uint8_t* base = mapped.data();
+        W = h->width; H = h->height;
+        player = { h->playerX, h->playerY };
+        walls.attach(W, H, (const uint64_t*)(base + h->wallsOffset));
+        voids.attach(W, H, (const uint64_t*)(base + h->voidsOffset));
+        goalBits.attach(W, H, (const uint64_t*)(base + h->goalsOffset));
+        resetBoxes();
+        const int32_t* bl = (const int32_t*)(base + h->boxesOffset);
+        for(uint32_t i=0; i<h->boxCount; ++i) addBox({ bl[2*i], bl[2*i+1] });
+        const int32_t* gl = (const int32_t*)(base + h->goalListOffset);
+        goals.resize(h->goalCount);
+        for(uint32_t i=0; i<h->goalCount; ++i) goals[i] = { gl[2*i], gl[2*i+1] };
+        goalsCovered = 0;
+        for(auto& b : boxes) goalsCovered += goalBits.test(b.x, b.y);
+        prefetched = { INT32_MIN, INT32_MIN };
+        prefetchAround(player);
+        return true;
+    }
+
+    // compiled copy of the loaded level (level_file.h)
+    bool saveBinary(const std::string& path) const {
+        using namespace level_file;
+        Header h{};
+        std::memcpy(h.magic, kMagic, 4);
+        h.version = kVersion;
+        h.width = W; h.height = H;
+        h.chunkShift = BitPlane::kChunkShift;
+        h.chunksX = walls.chunksX; h.chunksY = walls.chunksY;
+        h.playerX = player.x; h.playerY = player.y;
+        h.boxCount = (uint32_t)boxes.size(); h.goalCount = (uint32_t)goals.size();
+        h.planeBytes = walls.wordCount() * sizeof(uint64_t);
+        h.wallsOffset = alignUp(sizeof(Header));
+        h.voidsOffset = alignUp(h.wallsOffset + h.planeBytes);
+        h.goalsOffset = alignUp(h.voidsOffset + h.planeBytes);
+        h.boxesOffset = alignUp(h.goalsOffset + h.planeBytes);
+        h.goalListOffset = h.boxesOffset + (uint64_t)h.boxCount * 8;
+
+        std::ofstream f(path, std::ios::binary);
+        if(!f) return false;
+        auto pad = [&](uint64_t to){ static const char zeros[kAlign] = {}; f.write(zeros, (std::streamsize)(to - (uint64_t)f.tellp())); };
+        f.write((const char*)&h, sizeof h);
+        pad(h.wallsOffset); f.write((const char*)walls.data(), (std::streamsize)h.planeBytes);
+        pad(h.voidsOffset); f.write((const char*)voids.data(), (std::streamsize)h.planeBytes);
+        pad(h.goalsOffset); f.write((const char*)goalBits.data(), (std::streamsize)h.planeBytes);
+        pad(h.boxesOffset);
+        for(auto& b : boxes){ int32_t v[2] = { b.x, b.y }; f.write((const char*)v, sizeof v); }
+        for(auto& g : goals){ int32_t v[2] = { g.x, g.y }; f.write((const char*)v, sizeof v); }
+        return (bool)f;
+    }
+
+    // mapped levels: ask the OS for the plane chunks within `radius` chunks
+    // of tile p; a no-op while p stays in the same chunk
+    void prefetchAround(glm::ivec2 p, int radius = 2){
+        if(!mapped.isOpen()) return;
+        glm::ivec2 c = glm::clamp(p, glm::ivec2(0), glm::ivec2(W-1, H-1)) >> BitPlane::kChunkShift;
+        if(c == prefetched) return;
+        prefetched = c;
+        const level_file::Header* h = (const level_file::Header*)mapped.data();
+        int cx0 = std::max(0, c.x - radius), cx1 = std::min(walls.chunksX - 1, c.x + radius);
+        int cy0 = std::max(0, c.y - radius), cy1 = std::min(walls.chunksY - 1, c.y + radius);
+        const size_t chunkBytes = BitPlane::kChunk * sizeof(uint64_t);
+        for(uint64_t plane : { h->wallsOffset, h->voidsOffset, h->goalsOffset })
+            for(int cy=cy0; cy<=cy1; ++cy){
+                size_t first = ((size_t)cy * walls.chunksX + cx0) * chunkBytes;
+                mapped.prefetch((size_t)plane + first, (size_t)(cx1 - cx0 + 1) * chunkBytes);
+            }
+    }
+
+    bool inside(int x, int y) const { return x>=0 && y>=0 && x<W && y<H; }
+    size_t tileIndex(int x, int y) const { return (size_t)y*W + x; }
+
+    bool isWall(glm::ivec2 p) const {
+        if(!inside(p.x, p.y)) return true; // outside treated as wall
+        return walls.test(p.x, p.y) || voids.test(p.x, p.y);
+    }
+    // '#' tile only; outside the map is open (collision TileGrid interface)
+    bool wallAt(int x, int y) const {
+        return inside(x, y) && walls.test(x, y);
+    }
+    bool isGoal(glm::ivec2 p) const {
+        return inside(p.x, p.y) && goalBits.test(p.x, p.y);
+    }
+    bool occupiedByBox(glm::ivec2 p, int* idxOut=nullptr) const {
+        if(!inside(p.x, p.y) || !boxBits.test(p.x, p.y)) return false;
+        if(idxOut) *idxOut = boxIndex[tileIndex(p.x, p.y)];
+        return true;
+    }
+    // keeps boxes, boxBits, boxIndex and goalsCovered in step; false (and
+    // nothing moved) when another box holds `to`
+    bool moveBox(int idx, glm::ivec2 to){
+        glm::ivec2 from = boxes[idx];
+        if(to != from && inside(to.x, to.y) && boxBits.test(to.x, to.y)) return false;
+        if(inside(from.x, from.y) && boxBits.test(from.x, from.y) && boxIndex[tileIndex(from.x, from.y)] == idx){
+            boxBits.reset(from.x, from.y);
+            goalsCovered -= goalBits.test(from.x, from.y);
+        }
+        boxes[idx] = to;
+        if(inside(to.x, to.y)){
+            if(!boxBits.test(to.x, to.y)){ boxBits.set(to.x, to.y); goalsCovered += goalBits.test(to.x, to.y); }
+            boxIndex[tileIndex(to.x, to.y)] = idx;
+        }
+        return true;
+    }
+    // every goal covered
+    bool win() const { return goalsCovered == goals.size(); }
+
+private:
+    MappedFile mapped;              // backs walls/voids/goalBits for .sokb levels
+    glm::ivec2 prefetched{INT32_MIN, INT32_MIN};
+
+    // cell(x, c) per expanded tile, row(width) at every '\n' / '|' and at end
+    template<class CellFn, class RowFn>
+    static void scanSok(const char* p, const char* end, CellFn cell, RowFn row){
+        int x = 0, run = 0;
+        for(; p < end; ++p){
+            char c = *p;
+            if(c == '\r') continue;
+            if(c == '\n' || c == '|'){ row(x); x = 0; run = 0; continue; }
+            if(c >= '0' && c <= '9'){ run = run*10 + (c - '0'); continue; }
+            for(int k = std::max(run, 1); k > 0; --k) cell(x++, c);
+            run = 0;
+        }
+        row(x);
+    }
+
+    void resetBoxes(){
+        boxBits.resize(W, H);
+        boxIndex.reset(new int32_t[(size_t)std::max(W, 1) * std::max(H, 1)]);
+        boxes.clear();
+    }
+    void addBox(glm::ivec2 p){
+        if(!inside(p.x, p.y)) return;
+        boxIndex[tileIndex(p.x, p.y)] = (int32_t)boxes.size();
+        boxBits.set(p.x, p.y);
+        boxes.push_back(p);
+    }
+};
@@ -0,0 +1,235 @@
+#pragma once
+#include "profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool for per-frame CPU work. Every thread owns a deque: it
+// pushes and pops at the back (newest first, still warm in cache) and, when
+// empty, steals from the front of another thread's deque. The thread that
+// waits on a Counter keeps running jobs until it reaches zero, so the frame
+// thread is one of the workers and nested parallelFor calls cannot deadlock.
+//
+// Jobs are plain function pointer + context, so submitting one does not
+// allocate. JobGraph (below) layers a per-frame dependency graph on top.
+class JobSystem {
+public:
+    using Fn = void(*)(void* ctx, size_t begin, size_t end);
+    struct Counter { std::atomic<int> n{0}; };
+
+    // threads counts the calling thread too; 0 = hardware_concurrency
+    explicit JobSystem(int threads = 0){
+        if(threads <= 0) threads = (int)std::max(1u, std::thread::hardware_concurrency());
+        queues.reserve(threads);
+        for(int i=0; i<threads; ++i) queues.push_back(std::make_unique<Queue>());
+        for(int i=1; i<threads; ++i) pool.emplace_back([this, i]{ workerLoop(i); });
+    }
+    ~JobSystem(){
+        {
+            std::lock_guard<std::mutex> lk(sleepM);
+            quit = true;
+        }
+        sleepCv.notify_all();
+        for(auto& t : pool) t.join();
+    }
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    int threadCount() const { return (int)queues.size(); }
+    // 0 for the frame thread (and any other thread outside the pool)
+    int currentThread() const { return tlsOwner == this ? tlsIndex : 0; }
+
+    void submit(Fn fn, void* ctx, size_t begin, size_t end, Counter& done){
+        done.n.fetch_add(1, std::memory_order_relaxed);
+        Queue& q = *queues[currentThread()];
+        {
+            std::lock_guard<std::mutex> lk(q.m);
+            q.jobs.push_back({ fn, ctx, begin, end, &done });
+        }
+        if(pending.fetch_add(1, std::memory_order_release) < (int)pool.size()) sleepCv.notify_one();
+    }
+
+    // runs other jobs until every job counted on c has finished
+    void wait(Counter& c){
+        const int self = currentThread();
+        int spins = 0;
+        while(c.n.load(std::memory_order_acquire) > 0){
+            if(runOne(self)){ spins = 0; continue; }
+            if(++spins < 64) std::this_thread::yield();
+            else std::this_thread::sleep_for(std::chrono::microseconds(20));
+        }
+    }
+
+    // f(begin, end) over [0, n) in ranges of at least `grain` items, about
+    // four ranges per thread; returns when all ranges are done
+    template<class F>
+    void parallelFor(size_t n, size_t grain, F&& f){
+        if(n == 0) return;
+        size_t ranges = std::min((n + grain - 1) / std::max<size_t>(grain, 1), (size_t)threadCount() * 4);
+        if(ranges <= 1){ f((size_t)0, n); return; }
+        const size_t step = (n + ranges - 1) / ranges;
+        using Body = std::remove_reference_t<F>;
+        Fn tramp = [](void* ctx, size_t b, size_t e){ (*static_cast<Body*>(ctx))(b, e); };
+        Counter done;
+        for(size_t b = step; b < n; b += step) submit(tramp, (void*)&f, b, std::min(n, b + step), done);
+        f((size_t)0, std::min(n, step));      // first range inline
+        wait(done);
+    }
+
+private:
+    struct Job {
+        Fn fn;
+        void* ctx;
+        size_t begin, end;
+        Counter* done;
+    };
+    struct Queue {
+        std::mutex m;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;     // [0] = frame thread
+    std::vector<std::thread> pool;
+    std::atomic<int> pending{0};                    // submitted, not yet taken
+    std::mutex sleepM;
+    std::condition_variable sleepCv;
+    bool quit = false;
+
+    static inline thread_local JobSystem* tlsOwner = nullptr;
+    static inline thread_local int tlsIndex = 0;
+
+    bool take(int self, Job& out){
+        {
+            Queue& q = *queues[self];
+            std::lock_guard<std::mutex> lk(q.m);
+            if(!q.jobs.empty()){ out = q.jobs.back(); q.jobs.pop_back(); return true; }
+        }
+        const int n = (int)queues.size();
+        for(int k=1; k<n; ++k){
+            Queue& q = *queues[(self + k) % n];
+            std::lock_guard<std::mutex> lk(q.m);
+            if(!q.jobs.empty()){ out = q.jobs.front(); q.jobs.pop_front(); return true; }
+        }
+        return false;
+    }
+
+    bool runOne(int self){
+        Job j;
+        if(!take(self, j)) return false;
+        pending.fetch_sub(1, std::memory_order_relaxed);
+        j.fn(j.ctx, j.begin, j.end);
+        j.done->n.fetch_sub(1, std::memory_order_release);
+        return true;
+    }
+
+    void workerLoop(int index){
+        tlsOwner = this;
+        tlsIndex = index;
+        PROF_THREAD_NAME("job worker");
+        for(;;){
+            if(runOne(index)) continue;
+            std::unique_lock<std::mutex> lk(sleepM);
+            sleepCv.wait_for(lk, std::chrono::milliseconds(2), [&]{ return quit || pending.load(std::memory_order_acquire) > 0; });
+            if(quit) return;
+        }
+    }
+};
+
+// A small dependency graph, built once and run every frame. A job is
+// submitted as soon as the last job it depends on finishes; run() returns
+// when every job is done. Each run records per-job start/duration and the
+// thread that ran it, for checking how the frame scales with core count.
+class JobGraph {
+public:
+    using JobId = int;
+    struct Timing {
+        double startMs = 0, ms = 0;     // relative to the start of run()
+        int thread = 0;
+    };
+
+    JobId add(const char* name, std::function<void()> fn, std::initializer_list<JobId> deps = {}){
+        JobId id = (JobId)nodes.size();
+        nodes.push_back(std::make_unique<Node>());
+        Node& n = *nodes.back();
+        n.graph = this;
+        n.id = id;
+        n.name = name;
+        n.fn = std::move(fn);
+        for(JobId d : deps){ nodes[d]->next.push_back(id); n.deps++; }
+        timings.resize(nodes.size());
+        return id;
+    }
+
+    void run(JobSystem& js){
+        jobs = &js;
+        t0 = std::chrono::steady_clock::now();
+        for(auto& n : nodes) n->waiting.store(n->deps, std::memory_order_relaxed);
+        for(auto& n : nodes) if(n->deps == 0) js.submit(&Node::exec, n.get(), 0, 0, done);
+        js.wait(done);
+        wallMs = msSince(t0);
+    }
+
+    size_t size() const { return nodes.size(); }
+    const char* name(JobId id) const { return nodes[id]->name; }
+    const Timing& timing(JobId id) const { return timings[id]; }
+    double lastWallMs() const { return wallMs; }
+
+    // one line per job: start, duration and thread of the last run
+    void print(FILE* out) const {
+        std::fprintf(out, "[jobs] frame %.3f ms on %d threads\n", wallMs, jobs ? jobs->threadCount() : 1);
+        for(size_t i=0; i<nodes.size(); ++i)
+            std::fprintf(out, "  %-18s start %7.3f  took %7.3f ms  thread %d\n",
+                         nodes[i]->name, timings[i].startMs, timings[i].ms, timings[i].thread);
+    }
+
+private:
+    struct Node {
+        JobGraph* graph = nullptr;
+        JobId id = 0;
+        const char* name = "";
+        std::function<void()> fn;
+        std::vector<JobId> next;
+        int deps = 0;
+        std::atomic<int> waiting{0};
+
+        static void exec(void* ctx, size_t, size_t){
+            Node& n = *static_cast<Node*>(ctx);
+            JobGraph& g = *n.graph;
+            Timing& t = g.timings[n.id];
+            t.thread = g.jobs->currentThread();
+            auto start = std::chrono::steady_clock::now();
+            t.startMs = std::chrono::duration<double, std::milli>(start - g.t0).count();
+            {
+                PROF_ZONE(n.name);
+                n.fn();
+            }
+            t.ms = msSince(start);
+            for(JobId d : n.next){
+                Node& m = *g.nodes[d];
+                if(m.waiting.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    g.jobs->submit(&Node::exec, &m, 0, 0, g.done);
+            }
+        }
+    };
+
+    std::vector<std::unique_ptr<Node>> nodes;
+    std::vector<Timing> timings;
+    JobSystem* jobs = nullptr;
+    JobSystem::Counter done;
+    std::chrono::steady_clock::time_point t0;
+    double wallMs = 0;
+
+    static double msSince(std::chrono::steady_clock::time_point t){
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t).count();
+    }
+};
@@ -0,0 +1,206 @@
+#pragma once
+#include "mapped_file.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Standard Sokoban level collections (.xsb / .sok): thousands of levels in
+// one text file, boards in the usual notation
+//
+//   #  wall    @  player    $  box    .  goal    space - _  floor
+//              +  player on a goal    *  box on a goal
+//
+// with optional run-length rows ("3#" = "###", '|' ends a row). Text between
+// boards is metadata: a "Title:" line after a board names it, otherwise the
+// last comment or plain line before it does.
+//
+// open() maps the file and indexes it in one pass over the bytes: per level
+// only the offsets of its board and title are kept, nothing is decoded.
+// Grid::load(collection, i) decodes one board on demand.
+//
+// Level specs name one level of a collection wherever a level path is
+// accepted: "pack.xsb#12" (1-based number) or "pack.xsb#Title". A .xsb/.sok
+// path alone means its first level; expand() turns it into every level.
+class LevelCollection {
+public:
+    struct Level {
+        uint64_t board = 0, title = 0;          // byte offsets into the file
+        uint32_t boardBytes = 0, titleBytes = 0;
+    };
+
+    bool open(const std::string& filePath){
+        auto t0 = std::chrono::steady_clock::now();
+        levels.clear();
+        source.clear();
+        if(!file.open(filePath)) return false;
+        source = filePath;
+        index();
+        indexMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        return true;
+    }
+
+    const std::string& path() const { return source; }
+    size_t size() const { return levels.size(); }
+    std::string_view board(size_t i) const { return view(levels[i].board, levels[i].boardBytes); }
+    std::string_view title(size_t i) const { return view(levels[i].title, levels[i].titleBytes); }
+    double indexMs = 0.0;                       // last open()
+
+    // "12" = the 12th level, anything else an exact title (then ignoring
+    // case); -1 when there is no such level
+    long find(std::string_view which) const {
+        if(!which.empty() && std::all_of(which.begin(), which.end(), [](char c){ return c >= '0' && c <= '9'; })){
+            unsigned long n = std::strtoul(std::string(which).c_str(), nullptr, 10);
+            return n >= 1 && n <= levels.size() ? (long)n - 1 : -1;
+        }
+        for(size_t i=0; i<levels.size(); ++i) if(title(i) == which) return (long)i;
+        auto lower = [](char c){ return c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c; };
+        for(size_t i=0; i<levels.size(); ++i){
+            std::string_view t = title(i);
+            if(t.size() == which.size() && std::equal(t.begin(), t.end(), which.begin(), [&](char a, char b){ return lower(a) == lower(b); }))
+                return (long)i;
+        }
+        return -1;
+    }
+
+    static bool isCollectionPath(std::string_view p){
+        auto ends = [&](const char* ext){
+            size_t n = std::strlen(ext);
+            if(p.size() < n) return false;
+            for(size_t i=0; i<n; ++i){
+                char c = p[p.size() - n + i];
+                if((c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c) != ext[i]) return false;
+            }
+            return true;
+        };
+        return ends(".xsb") || ends(".sok");
+    }
+    // "pack.xsb#12" -> ("pack.xsb", "12"); "pack.sok" -> ("pack.sok", "1");
+    // false for anything that is not a collection level (plain level files,
+    // '#' in their path included)
+    static bool splitSpec(const std::string& spec, std::string& filePath, std::string& which){
+        size_t hash = spec.rfind('#');
+        if(hash != std::string::npos && hash + 1 < spec.size() && isCollectionPath(std::string_view(spec).substr(0, hash))){
+            filePath = spec.substr(0, hash);
+            which = spec.substr(hash + 1);
+            return true;
+        }
+        if(!isCollectionPath(spec)) return false;
+        filePath = spec;
+        which.assign(1, '1');
+        return true;
+    }
+    // the file behind a level spec (content hashing, existence checks)
+    static std::string filePathOf(const std::string& spec){
+        std::string p, w;
+        return splitSpec(spec, p, w) ? p : spec;
+    }
+    // a bare collection path becomes one spec per level; anything else is
+    // passed through. False when a collection cannot be opened.
+    static bool expand(const std::string& arg, std::vector<std::string>& out){
+        if(!isCollectionPath(arg)){ out.push_back(arg); return true; }
+        LevelCollection c;
+        if(!c.open(arg)) return false;
+        for(size_t i=0; i<c.size(); ++i) out.push_back(arg + "#" + std::to_string(i + 1));
+        return true;
+    }
+
+    // a board row: only board characters, run lengths and row breaks, with
+    // at least one wall (rules out level numbers and blank lines)
+    static bool isBoardRow(const char* p, const char* end){
+        static constexpr auto kClass = []{
+            std::array<uint8_t, 256> t{};       // 1 board character, 2 wall
+            for(unsigned char c : std::string_view(" -_@+$*.|0123456789")) t[c] = 1;
+            t['#'] = 2;
+            return t;
+        }();
+        uint8_t any = 0;
+        for(; p < end; ++p){
+            uint8_t k = kClass[(unsigned char)*p];
+            if(!k) return false;
+            any |= k;
+        }
+        return (any & 2) != 0;
+    }
+
+private:
+    MappedFile file;
+    std::string source;
+    std::vector<Level> levels;
+
+    std::string_view view(uint64_t off, uint32_t n) const { return { (const char*)file.data() + off, n }; }
+
+    void index(){
+        const char* base = (const char*)file.data();
+        const char* end = base + file.size();
+        bool inBoard = false, closedSinceTitle = false;
+        const char* boardEnd = nullptr;
+        Level cur;
+        uint64_t noteOff = 0;                   // last candidate title line
+        uint32_t noteLen = 0;
+        for(const char* p = base; p < end; ){
+            const char* nl = (const char*)std::memchr(p, '\n', (size_t)(end - p));
+            const char* le = nl ? nl : end;
+            const char* next = nl ? nl + 1 : end;
+            if(le > p && le[-1] == '\r') --le;
+
+            if(le > p && isBoardRow(p, le)){
+                if(!inBoard){
+                    cur = Level{};
+                    cur.board = (uint64_t)(p - base);
+                    cur.title = noteOff;
+                    cur.titleBytes = noteLen;
+                    inBoard = true;
+                }
+                boardEnd = le;
+                p = next;
+                continue;
+            }
+            if(inBoard){
+                cur.boardBytes = (uint32_t)(boardEnd - (base + cur.board));
+                levels.push_back(cur);
+                inBoard = false;
+                closedSinceTitle = true;
+                noteLen = 0;
+            }
+
+            // metadata line: trim, then "Title:" or a title candidate
+            const char* a = p;
+            const char* b = le;
+            while(a < b && (*a == ' ' || *a == '\t')) ++a;
+            bool comment = a < b && *a == ';';
+            while(a < b && (*a == ' ' || *a == '\t' || *a == ';')) ++a;
+            while(b > a && (b[-1] == ' ' || b[-1] == '\t')) --b;
+            p = next;
+            if(a == b) continue;
+            std::string_view line(a, (size_t)(b - a));
+            if(line.size() >= 6 && (line.compare(0, 6, "Title:") == 0 || line.compare(0, 6, "title:") == 0)){
+                std::string_view t = line.substr(6);
+                while(!t.empty() && t.front() == ' ') t.remove_prefix(1);
+                if(!levels.empty() && closedSinceTitle){
+                    Level& last = levels.back();
+                    last.title = (uint64_t)(t.data() - base);
+                    last.titleBytes = (uint32_t)t.size();
+                    closedSinceTitle = false;
+                }
+                continue;
+            }
+            // "Author: x" and the like belong to the level above
+            size_t colon = line.find(':');
+            bool tag = colon != std::string_view::npos && colon > 0 && line.find(' ') > colon;
+            if(!tag || comment){
+                noteOff = (uint64_t)(a - base);
+                noteLen = (uint32_t)line.size();
+            }
+        }
+        if(inBoard){
+            cur.boardBytes = (uint32_t)(boardEnd - (base + cur.board));
+            levels.push_back(cur);
+        }
+    }
+};
@@ -0,0 +1,65 @@
+#pragma once
+#include "mapped_file.h"
+#include <cstdint>
+#include <cstring>
+
+// Compiled level format (.sokb), written by level_convert and read by
+// Grid::load straight from a memory map:
+//
+//   LevelFileHeader
+//   walls / voids / goals planes   BitPlane chunk layout, each page aligned
+//   box list, goal list            int32 (x, y) pairs, grid coordinates
+//
+// Planes are used in place (no copy, no parse), so opening a level costs the
+// same whatever its size; the OS pages chunks in as they are touched and
+// Grid::prefetchAround asks for the ones near the player ahead of time.
+namespace level_file {
+
+constexpr char     kMagic[4] = { 'S', 'O', 'K', 'B' };
+constexpr uint32_t kVersion  = 1;
+constexpr uint64_t kAlign    = 4096;
+
+struct Header {
+    char     magic[4];
+    uint32_t version;
+    int32_t  width, height;
+    int32_t  chunkShift;              // BitPlane::kChunkShift at write time
+    int32_t  chunksX, chunksY;
+    int32_t  playerX, playerY;
+    uint32_t boxCount, goalCount;
+    uint32_t reserved;
+    uint64_t planeBytes;              // size of one plane
+    uint64_t wallsOffset, voidsOffset, goalsOffset;
+    uint64_t boxesOffset, goalListOffset;
+};
+static_assert(sizeof(Header) % 8 == 0, "Header keeps the lists 8-byte aligned");
+
+inline uint64_t alignUp(uint64_t v){ return (v + kAlign - 1) / kAlign * kAlign; }
+
+inline bool isLevelFile(const MappedFile& f){
+    return f.size() >= sizeof(Header) && std::memcmp(f.data(), kMagic, 4) == 0;
+}
+
+// header if the file is complete, matches this build's chunk layout and
+// keeps the player and goals on the board
+inline const Header* validate(const MappedFile& f, int chunkShift){
+    if(!isLevelFile(f)) return nullptr;
+    const Header* h = (const Header*)f.data();
+    if(h->version != kVersion || h->chunkShift != chunkShift) return nullptr;
+    if(h->width <= 0 || h->height <= 0) return nullptr;
+    const int64_t chunk = int64_t(1) << chunkShift;
+    if(h->chunksX != (h->width + chunk - 1) / chunk || h->chunksY != (h->height + chunk - 1) / chunk) return nullptr;
+    if(h->planeBytes != (uint64_t)h->chunksX * h->chunksY * chunk * sizeof(uint64_t)) return nullptr;
+    auto fits = [&](uint64_t off, uint64_t len){ return off <= f.size() && len <= f.size() - off; };
+    if(!fits(h->wallsOffset, h->planeBytes) || !fits(h->voidsOffset, h->planeBytes) || !fits(h->goalsOffset, h->planeBytes)) return nullptr;
+    if(!fits(h->boxesOffset, (uint64_t)h->boxCount * 8) || !fits(h->goalListOffset, (uint64_t)h->goalCount * 8)) return nullptr;
+    if((h->wallsOffset | h->voidsOffset | h->goalsOffset | h->boxesOffset | h->goalListOffset) % 8) return nullptr;
+    // Grid indexes planes with these unchecked (boxes are bounds-checked as they are added)
+    auto inside = [&](int32_t x, int32_t y){ return x >= 0 && y >= 0 && x < h->width && y < h->height; };
+    if(!inside(h->playerX, h->playerY)) return nullptr;
+    const int32_t* gl = (const int32_t*)(f.data() + h->goalListOffset);
+    for(uint32_t i=0; i<h->goalCount; ++i) if(!inside(gl[2*i], gl[2*i+1])) return nullptr;
+    return h;
+}
+
+} // namespace level_file
@@ -0,0 +1,247 @@
+#include "level_gen.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <thread>
+
+namespace {
+
+// small, seedable, same sequence on every platform (unlike std distributions)
+struct SplitMix {
+    uint64_t s;
+    explicit SplitMix(uint64_t seed) : s(seed) {}
+    uint64_t next(){
+        uint64_t z = (s += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    int below(int n){ return (int)(next() % (uint64_t)n); }
+    float unit(){ return (float)(next() >> 40) * (1.0f / 16777216.0f); }
+};
+
+// ---- random mode ----
+
+void generateRandom(const LevelGenParams& p, GeneratedLevel& L, LevelGenStats& st){
+    SplitMix rng(p.seed);
+    long floors = 0;
+    for(int y=0; y<L.height; ++y)
+        for(int x=0; x<L.width; ++x){
+            bool border = x==0 || y==0 || x==L.width-1 || y==L.height-1;
+            bool wall = border || rng.unit() < p.wallDensity;
+            L.at(x, y) = wall ? '#' : ' ';
+            floors += !wall;
+        }
+    if(floors == 0){ L.at(1, 1) = ' '; floors = 1; }
+    long crates = p.crates >= 0 ? p.crates : std::lround(p.crateDensity * floors);
+    crates = std::clamp(crates, 0L, (floors - 1) / 3);   // rejection sampling stays cheap
+    auto place = [&](char c){
+        for(;;){
+            int x = 1 + rng.below(L.width-2), y = 1 + rng.below(L.height-2);
+            if(L.at(x, y) == ' '){ L.at(x, y) = c; return; }
+        }
+    };
+    place('P');
+    for(long i=0; i<crates; ++i){ place('B'); place('.'); }
+    st.crates = (int)crates;
+}
+
+// ---- reverse mode ----
+
+struct Layout {
+    int R, nx, ny;
+    int roomX(int k) const { return 3 + k * (R + 1); }
+    int roomY(int j) const { return 1 + j * (R + 3); }
+};
+
+// one room, generated by pulling crates off their goals; local cell = y*R + x
+struct RoomGen {
+    enum : uint8_t { Floor = 0, Wall = 1, Box = 2, Goal = 4, Moved = 8 };
+    int R;
+    std::vector<uint8_t> cell;
+    std::vector<int> stack;
+
+    explicit RoomGen(int r) : R(r), cell((size_t)r * r) {}
+
+    bool inside(int x, int y) const { return x >= 0 && y >= 0 && x < R && y < R; }
+
+    // cells reachable from `from` without crossing walls or crates
+    int flood(int from, std::vector<uint8_t>& seen, uint8_t blockMask){
+        std::fill(seen.begin(), seen.end(), 0);
+        stack.assign(1, from);
+        seen[from] = 1;
+        int n = 0;
+        static const int dx[4] = { 1, -1, 0, 0 }, dy[4] = { 0, 0, 1, -1 };
+        while(!stack.empty()){
+            int c = stack.back(); stack.pop_back(); ++n;
+            int x = c % R, y = c / R;
+            for(int d=0; d<4; ++d){
+                int nx = x + dx[d], ny = y + dy[d];
+                if(!inside(nx, ny)) continue;
+                int nc = ny * R + nx;
+                if(seen[nc] || (cell[nc] & blockMask)) continue;
+                seen[nc] = 1;
+                stack.push_back(nc);
+            }
+        }
+        return n;
+    }
+
+    // true when the room holds crates that need solving; entry = (doorX, R-1)
+    bool generate(SplitMix& rng, const LevelGenParams& p, int entry, int& frozen){
+        static const int dx[4] = { 1, -1, 0, 0 }, dy[4] = { 0, 0, 1, -1 };
+        std::vector<uint8_t> seen(cell.size());
+        for(int attempt=0; attempt<4; ++attempt){
+            // walls, then wall off whatever the entry cannot reach
+            for(auto& c : cell) c = rng.unit() < p.wallDensity ? Wall : Floor;
+            cell[entry] = Floor;
+            int floors = flood(entry, seen, Wall);
+            for(size_t i=0; i<cell.size(); ++i) if(!seen[i]) cell[i] = Wall;
+
+            int crates = std::min((int)std::lround(p.crateDensity * floors), (floors - 1) / 3);
+            if(crates <= 0) return false;
+            for(int placed=0; placed<crates; ){
+                int c = rng.below((int)cell.size());
+                if(c == entry || cell[c] != Floor) continue;
+                cell[c] = Box | Goal;
+                ++placed;
+            }
+
+            // random walk from the entry; stepping away from an adjacent
+            // crate may pull it one tile, but never onto a goal (the text
+            // format has no crate-on-goal tile) or the entry. Once enough
+            // pulls are done, stop as soon as the entry can reach the player.
+            int player = entry, pulls = 0;
+            const int targetPulls = crates * std::max(1, p.pullsPerCrate);
+            const long maxSteps = (long)targetPulls * 16 + (long)R * R * 8;
+            bool ok = false;
+            for(long s=0; s<maxSteps && !ok; ++s){
+                int d = rng.below(4);
+                int x = player % R, y = player / R;
+                int tx = x + dx[d], ty = y + dy[d];
+                if(!inside(tx, ty)) continue;
+                int to = ty * R + tx;
+                if(cell[to] & (Wall | Box)) continue;
+                int bx = x - dx[d], by = y - dy[d];
+                if(inside(bx, by) && (cell[by * R + bx] & Box) && !(cell[player] & Goal) && player != entry && (rng.next() & 1)){
+                    int from = by * R + bx;
+                    cell[from] &= ~(Box | Moved);
+                    cell[player] |= Box | Moved;
+                    ++pulls;
+                }
+                player = to;
+                bool enough = pulls >= targetPulls || s >= maxSteps / 2;
+                if(enough && (s & 31) == 0){
+                    flood(entry, seen, Wall | Box);
+                    ok = seen[player] != 0;
+                }
+            }
+            if(!ok) continue;
+
+            // crates never pulled still sit on their goals: static, so walls
+            for(auto& c : cell){
+                if((c & Box) && !(c & Moved)){ c = Wall; ++frozen; }
+            }
+            for(auto c : cell) if(c & Box) return true;
+            return false;
+        }
+        for(auto& c : cell) if(c != Wall) c = Floor;   // give up: an empty room is trivially solved
+        return false;
+    }
+};
+
+bool generateReverse(const LevelGenParams& p, GeneratedLevel& L, LevelGenStats& st, std::string* err){
+    Layout lay;
+    lay.R = std::min({ p.room, L.width - 4, L.height - 4 });
+    if(lay.R < 2){ if(err) *err = "map too small for a room"; return false; }
+    lay.nx = (L.width - 3) / (lay.R + 1);
+    lay.ny = (L.height - 1) / (lay.R + 3);
+    const int R = lay.R;
+
+    std::fill(L.tiles.begin(), L.tiles.end(), '#');
+    // hallways: column x=1 plus one row under every row of rooms
+    const int lastHall = lay.roomY(lay.ny - 1) + R + 1;
+    const int hallEnd = lay.roomX(lay.nx - 1) + R - 1;
+    for(int y=1; y<=lastHall; ++y) L.at(1, y) = ' ';
+    for(int j=0; j<lay.ny; ++j){
+        int hy = lay.roomY(j) + R + 1;
+        for(int x=1; x<=hallEnd; ++x) L.at(x, hy) = ' ';
+    }
+    L.at(1, 1) = 'P';
+
+    const int rooms = lay.nx * lay.ny;
+    std::atomic<int> next{0}, crates{0}, frozen{0}, fallback{0};
+    auto worker = [&]{
+        RoomGen g(R);
+        for(int r; (r = next.fetch_add(1)) < rooms; ){
+            int k = r % lay.nx, j = r / lay.nx;
+            int ox = lay.roomX(k), oy = lay.roomY(j);
+            SplitMix rng(((uint64_t)p.seed << 32) ^ (uint64_t)r * 0x9E3779B97F4A7C15ull);
+            int doorX = rng.below(R);
+            int frozenHere = 0;
+            bool hasCrates = g.generate(rng, p, (R - 1) * R + doorX, frozenHere);
+            if(!hasCrates && p.crateDensity > 0.0f) fallback.fetch_add(1);
+            frozen.fetch_add(frozenHere);
+            int n = 0;
+            for(int y=0; y<R; ++y)
+                for(int x=0; x<R; ++x){
+                    uint8_t c = g.cell[y * R + x];
+                    char t = ' ';
+                    if(c & RoomGen::Wall) t = '#';
+                    else if(c & RoomGen::Box){ t = 'B'; ++n; }
+                    else if(c & RoomGen::Goal) t = '.';
+                    L.at(ox + x, oy + y) = t;
+                }
+            L.at(ox + doorX, oy + R) = ' ';
+            crates.fetch_add(n);
+        }
+    };
+    int threads = p.threads > 0 ? p.threads : (int)std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, rooms);
+    std::vector<std::thread> pool;
+    for(int t=1; t<threads; ++t) pool.emplace_back(worker);
+    worker();
+    for(auto& t : pool) t.join();
+
+    st.rooms = rooms;
+    st.roomsFallback = fallback;
+    st.crates = crates;
+    st.wallsFromCrates = frozen;
+    return true;
+}
+
+} // namespace
+
+std::string GeneratedLevel::toText() const {
+    std::string out;
+    out.reserve((size_t)(width + 1) * height);
+    for(int y=0; y<height; ++y){
+        out.append(&tiles[(size_t)y * width], (size_t)width);
+        out += '\n';
+    }
+    return out;
+}
+
+bool GeneratedLevel::save(const std::string& path) const {
+    std::ofstream f(path, std::ios::binary);
+    if(!f) return false;
+    std::string text = toText();
+    f.write(text.data(), (std::streamsize)text.size());
+    return (bool)f;
+}
+
+bool generateLevel(const LevelGenParams& p, GeneratedLevel& out, LevelGenStats* stats, std::string* err){
+    auto t0 = std::chrono::steady_clock::now();
+    LevelGenStats st;
+    out.width  = std::clamp(p.width,  LevelGenParams::kMinSize, LevelGenParams::kMaxSize);
+    out.height = std::clamp(p.height, LevelGenParams::kMinSize, LevelGenParams::kMaxSize);
+    out.tiles.assign((size_t)out.width * out.height, '#');
+    bool ok = true;
+    if(p.mode == LevelGenParams::Mode::Random) generateRandom(p, out, st);
+    else ok = generateReverse(p, out, st, err);
+    st.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if(stats) *stats = st;
+    return ok;
+}
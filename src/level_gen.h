@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Synthetic levels in the Grid::load text format ('#' wall, '.' goal,
+// 'B' crate, 'P' player, ' ' floor) for scale and stress testing.
+//
+// Random mode scatters walls, crates and goals with no solvability promise.
+// Reverse mode splits the map into rooms (interior `room` x `room`) that
+// open through one door onto a hallway network. Each room starts solved
+// (crates on goals) and the player walks and *pulls* crates from the door;
+// replaying those moves backwards is a solution, and the hallways stay
+// crate-free, so the whole level is solvable one room at a time. Rooms are
+// generated in parallel with per-room seeds, so output depends only on the
+// parameters.
+
+struct LevelGenParams {
+    enum class Mode { Random, Reverse };
+    Mode mode = Mode::Reverse;
+    int width = 64, height = 64;        // clamped to [kMinSize, kMaxSize]
+    float wallDensity = 0.10f;          // interior tiles turned into walls
+    float crateDensity = 0.05f;         // crates per floor tile (== goals)
+    int crates = -1;                    // random mode: exact count, overrides crateDensity
+    int room = 12;                      // reverse mode: room interior size
+    int pullsPerCrate = 12;             // reverse mode: walk length ~ crates * this
+    uint32_t seed = 1;
+    int threads = 0;                    // 0 = hardware_concurrency
+
+    static constexpr int kMinSize = 5, kMaxSize = 4096;
+};
+
+struct LevelGenStats {
+    int rooms = 0;
+    int roomsFallback = 0;              // rooms left without crates after retries
+    int crates = 0;
+    int wallsFromCrates = 0;            // crates never pulled, frozen into walls
+    double seconds = 0.0;
+};
+
+struct GeneratedLevel {
+    int width = 0, height = 0;
+    std::vector<char> tiles;            // row-major, row 0 = first text line
+
+    char& at(int x, int y) { return tiles[(size_t)y * width + x]; }
+    char  at(int x, int y) const { return tiles[(size_t)y * width + x]; }
+    std::string toText() const;
+    bool save(const std::string& path) const;
+};
+
+// false + message on bad parameters (e.g. map too small for one room)
+bool generateLevel(const LevelGenParams& p, GeneratedLevel& out, LevelGenStats* stats = nullptr, std::string* err = nullptr);
@@ -0,0 +1,141 @@
+#pragma once
+#include "broadphase.h"
+#include "culling.h"
+#include "deadlock.h"
+#include "entity_store.h"
+#include "grid.h"
+#include "profiler.h"
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Everything loading a level builds from its file before it touches the
+// running game: grid, start colliders and their broadphase, culling chunks,
+// dead squares, and whatever render data the frontend derives from them.
+// Simulation fills one either on the spot or ahead of time on
+// LevelPipeline's worker, then moves it in, so both paths end in the same
+// state.
+struct PreparedLevel {
+    int index = -1;                     // into Simulation::levels
+    bool loaded = false;
+    Grid grid;
+    EntityStore crates, actors;
+    EntityId player;
+    BodyHash boxHash;                   // crates at their start cells
+    TileChunks chunks;
+    DeadlockAnalyzer deadlock;
+    std::shared_ptr<void> render;       // Simulation::prepareRender's result, if any
+    double buildMs = 0.0;
+};
+
+// Builds one level at a time on a worker thread, started on first use and
+// kept for the next levels. start() returns at once; take() hands the result
+// over, waiting for the worker if it is still busy. Every take() waits for
+// the build in flight, so it never overlaps the caller's own level loads and
+// may use the caller's state (collection index) freely. The level swapped
+// out goes back through retire() and is freed on the worker as well.
+class LevelPipeline {
+public:
+    using Build = std::function<void(PreparedLevel&)>;
+
+    LevelPipeline() = default;
+    LevelPipeline(const LevelPipeline&) = delete;
+    LevelPipeline& operator=(const LevelPipeline&) = delete;
+    ~LevelPipeline(){
+        if(!worker.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lk(m);
+            quit = true;
+        }
+        cv.notify_all();
+        worker.join();
+    }
+
+    // no-op while `index` is already being prepared or waiting to be taken
+    void start(int index, Build build){
+        if(index == target) return;
+        drop();
+        target = index;
+        result = std::make_unique<PreparedLevel>();
+        result->index = index;
+        launch();
+        {
+            std::lock_guard<std::mutex> lk(m);
+            job = std::move(build);
+            busy = true;
+        }
+        cv.notify_all();
+    }
+    // frees a level off the caller's thread (big levels take tens of ms)
+    void retire(std::unique_ptr<PreparedLevel> old){
+        if(!old) return;
+        launch();
+        {
+            std::lock_guard<std::mutex> lk(m);
+            retired.push_back(std::move(old));
+        }
+        cv.notify_all();
+    }
+    int preparing() const { return target; }   // -1 when idle
+
+    // the prepared level if it is `index`, otherwise null (and whatever was
+    // prepared is dropped); waitMs says how long the worker was waited for
+    std::unique_ptr<PreparedLevel> take(int index){
+        auto t0 = std::chrono::steady_clock::now();
+        {
+            std::unique_lock<std::mutex> lk(m);
+            cv.wait(lk, [&]{ return !busy; });
+        }
+        waitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        std::unique_ptr<PreparedLevel> r;
+        if(target == index && index >= 0) r = std::move(result);
+        result.reset();
+        target = -1;
+        return r;
+    }
+    void drop(){ take(-1); }
+
+    double waitMs = 0.0;                // last take()
+
+private:
+    std::thread worker;
+    std::mutex m;
+    std::condition_variable cv;
+    Build job;                          // guarded by m, with busy and retired
+    bool busy = false, quit = false;
+    std::vector<std::unique_ptr<PreparedLevel>> retired;
+    std::unique_ptr<PreparedLevel> result;     // owner thread; the worker fills *result while busy
+    int target = -1;
+
+    void launch(){
+        if(!worker.joinable()) worker = std::thread([this]{ workerLoop(); });
+    }
+    void workerLoop(){
+        PROF_THREAD_NAME("level pipeline");
+        std::unique_lock<std::mutex> lk(m);
+        for(;;){
+            cv.wait(lk, [&]{ return quit || job || !retired.empty(); });
+            if(quit) return;
+            if(!job){
+                auto old = std::move(retired);
+                retired.clear();
+                lk.unlock();
+                old.clear();
+                lk.lock();
+                continue;
+            }
+            Build build = std::move(job);
+            job = nullptr;
+            PreparedLevel* r = result.get();
+            lk.unlock();
+            build(*r);
+            lk.lock();
+            busy = false;
+            cv.notify_all();
+        }
+    }
+};
@@ -12,77 +12,22 @@
 #include "camera.h"
 #include "mesh.h"
 #include "model.h"
-#include "collision.h"
+#include "simulation.h"
+#include "replay.h"
+#include "uniform_buffer.h"
+#include "asset_loader.h"
+#include "profiler.h"
+#include "gpu_timer.h"
+#include "job_system.h"
+#include <atomic>
 #include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 static int SCR_W=1280, SCR_H=720;
 
-struct Cell { enum T {Floor, Wall, Goal} type=Floor; };
-
-struct Grid {
-    std::vector<std::string> raw;
-    int W=0, H=0;
-    glm::ivec2 player{1,1};
-    std::vector<glm::ivec2> boxes;
-    std::vector<glm::ivec2> goals;
-
-    bool load(const std::string& path){
-        std::ifstream f(path);
-        if(!f) return false;
-        raw.clear();
-        std::string line;
-        while(std::getline(f, line)){
-            if(!line.empty() && line.back()=='\r') line.pop_back();
-            raw.push_back(line);
-        }
-        H = (int)raw.size();
-        W = 0;
-        for(auto& s: raw) W = std::max(W,(int)s.size());
-
-        boxes.clear(); goals.clear();
-        for(int y=0;y<H;++y){
-            for(int x=0;x<(int)raw[y].size();++x){
-                char c = raw[y][x];
-                if(c=='P') player = {x, H-1-y};
-                if(c=='B') boxes.push_back({x, H-1-y});
-                if(c=='.') goals.push_back({x, H-1-y});
-            }
-        }
-        return true;
-    }
-
-    bool isWall(glm::ivec2 p) const {
-        int x=p.x, y=p.y;
-        int ry = H-1-y;
-        if(ry<0||ry>=H||x<0||x>= (int)raw[ry].size()) return true; // outside treated as wall
-        return raw[ry][x]=='#';
-    }
-    bool isGoal(glm::ivec2 p) const {
-        for(auto& g: goals) if(g==p) return true;
-        return false;
-    }
-    bool occupiedByBox(glm::ivec2 p, int* idxOut=nullptr) const {
-        for(size_t i=0;i<boxes.size();++i) if(boxes[i]==p){ if(idxOut) *idxOut=(int)i; return true; }
-        return false;
-    }
-    bool win() const {
-        for(auto& g: goals){
-            if(!occupiedByBox(g)) return false;
-        }
-        return true;
-    }
-
-};
-
-struct Entity {
-    AABB box;
-    glm::vec3 world; 
-    glm::vec3 color;
-    float scale = 1.0f;
-};
-
-
-
 // simple unit cube mesh for fallback
 Mesh makeCube(){
     Mesh m;
@@ -117,238 +62,265 @@ Mesh makeCube(){
     return m;
 }
 
+// what the static tile batches depend on: floor/wall tiles drawn as models
+// or as cubes (different transforms)
+struct TileStyle {
+    bool floorModel = false, wallModel = false;
+    bool operator==(const TileStyle&) const = default;
+};
+
 struct Assets {
     Model player, box, wall, floor;
     bool hasPlayer=false, hasBox=false, hasWall=false, hasFloor=false;
     Mesh cube;
-    void load(){
+    uint32_t version = 0;   // bumps whenever a model arrives; batches depending on has* rebuild
+    // 16-byte quantized vertices + 16-bit indices; Float keeps the 32-byte layout
+    static constexpr VertexFormat kModelFormat = VertexFormat::Quantized;
+    // cube fallback now, real models arrive through loader.pump() on later frames
+    void load(AssetLoader& loader){
         cube = makeCube();
-        hasPlayer = player.load("assets/models/player.gltf") || player.load("assets/models/player.obj");
-        hasBox    = box.load("assets/models/box.gltf")    || box.load("assets/models/box.obj");
-        hasWall   = wall.load("assets/models/wall.gltf")   || wall.load("assets/models/wall.obj");
-        hasFloor  = floor.load("assets/models/floor.gltf")  || floor.load("assets/models/floor.obj");
+        auto request = [&](Model& m, bool& has, const std::string& name){
+            m.format = kModelFormat;
+            loader.request(&m, { "assets/models/" + name + ".gltf", "assets/models/" + name + ".obj" },
+                           [this, &has](bool ok){ has = ok; if(ok) ++version; });
+        };
+        request(player, hasPlayer, "player");
+        request(box,    hasBox,    "box");
+        request(wall,   hasWall,   "wall");
+        request(floor,  hasFloor,  "floor");
     }
+    TileStyle tileStyle() const { return { hasFloor, hasWall }; }
     void drawModelOrCube(Model& m, bool has, Shader& sh){
         if(has) m.draw();
         else    cube.draw();
     }
+    void drawModelOrCubeInstanced(Model& m, bool has, const InstanceBuffer& ib, float pixelsPerUnit = 1e30f, GLsizei first = 0, GLsizei count = -1){
+        if(has) m.drawInstanced(ib, pixelsPerUnit, first, count);
+        else    cube.drawInstanced(ib, 0, first, count);
+    }
 };
 
-// Globals
-Camera gCam;
-Grid gGrid;
-Assets gAssets;
-glm::vec3 gPlayerWorld{0,0,0};
-glm::vec3 gMoveAnimStart{0,0,0};
-glm::vec3 gMoveAnimEnd{0,0,0};
-float gMoveT=1.0f; // 1 = idle
-glm::ivec2 gDir{0,0};
-
-std::vector<AABB> gStaticWalls;  
-Entity gPlayerEnt;
-std::vector<Entity> gBoxEnts;
-
-static inline bool boxOnGoal(const Entity& e, const glm::ivec2& g) {
-    // เผื่อคลาดจุดศูนย์กลางเล็กน้อย
-    const float tol = 0.3f; // กล่องอยู่ใน cell +-0.3
-    return std::abs(e.box.center.x - g.x) <= tol &&
-        std::abs(e.box.center.y - g.y) <= tol;
+static glm::mat4 tileTransform(glm::vec3 pos, glm::vec3 scl){
+    return glm::scale(glm::translate(glm::mat4(1.0f), pos), scl);
 }
 
-bool winAABB() {
-    for (const auto& g : gGrid.goals) {
-        bool covered = false;
-        for (const auto& e : gBoxEnts) {
-            if (boxOnGoal(e, g)) { covered = true; break; }
-        }
-        if (!covered) return false;
-    }
-    return true;
-}
+// Instance batches: floors/walls/goals are built once per level (when the
+// simulation's levelSerial changes), crates are refreshed every frame.
+// Static tiles are stored chunk by chunk (TileChunks order) so the instances
+// of chunk c are [start[c], start[c+1]) and visible chunks draw as runs.
+// Building, culling and crate instances run on the job system; upload() and
+// the draws stay on the GL thread. The next level's tiles can also be built
+// ahead on the level pipeline worker and adopted when it becomes current.
+struct ChunkedBatch {
+    InstanceBuffer ib;
+    std::vector<GLsizei> start;     // size() == chunk count + 1
+    std::vector<float> pixelsPerUnit;   // per chunk, LOD input from the last cull() (visible chunks)
+};
 
-static inline AABB makeTileAABB(int gx, int gy) {
-    return { glm::vec2(gx, gy), glm::vec2(0.5f, 0.5f) };
+// LOD input for one instance: screen pixels per model unit at its largest
+// axis scale, seen from `cam`
+static float instancePixelsPerUnit(const InstanceData& d, const Camera& cam, float viewportH){
+    float s = std::max({ glm::length(glm::vec3(d.model[0])), glm::length(glm::vec3(d.model[1])), glm::length(glm::vec3(d.model[2])) });
+    return s * cam.pixelsPerUnit(glm::vec3(d.model[3]), viewportH);
 }
 
-std::vector<std::string> gLevels = {
-    "assets/levels/level01.txt",
-    "assets/levels/level02.txt",
-    "assets/levels/level03.txt"
+// per-frame culling result, chunks and the static instances they hold
+struct CullStats {
+    int chunksVisible = 0, chunksCulled = 0;
+    size_t tilesDrawn = 0, tilesCulled = 0;
 };
-int   gLevelIndex = 0;
-bool  gAllCleared = false;
-float gWinTimer = 0.0f;
 
-void loadCurrentLevel() {
-    if (!gGrid.load(gLevels[gLevelIndex])) {
-        std::cerr << "Failed to load level: " << gLevels[gLevelIndex] << "\n";
-    }
-
-    // 1) สร้าง AABB ของกำแพงจากแผนที่ (#)
-    gStaticWalls.clear();
-    for (int y = 0; y < gGrid.H; ++y) {
-        for (int x = 0; x < gGrid.W; ++x) {
-            int ry = gGrid.H - 1 - y;
-            if (ry >= 0 && ry < gGrid.H && x < (int)gGrid.raw[ry].size() && gGrid.raw[ry][x] == '#') {
-                gStaticWalls.push_back(makeTileAABB(x, y)); // half = {0.5,0.5}
+struct LevelBatches {
+    ChunkedBatch floors, walls, goals;
+    InstanceBuffer boxes;
+    std::vector<uint8_t> visible;   // per chunk, from the last cull()
+    CullStats stats;
+    TileStyle style;                // what the static batches were built with
+    uint32_t serial = ~0u;
+    uint32_t assetVersion = ~0u;
+
+    // two passes over the chunks: instance counts (-> start offsets), then
+    // every chunk fills its own slice, so both passes split across threads
+    // (serial without a job system: the level pipeline worker)
+    void build(const Grid& g, const TileChunks& chunks, TileStyle ts, JobSystem* jobs){
+        const int n = chunks.size();
+        const int K = TileChunks::kSize;
+        auto forTiles = [&](int c, auto&& fn){
+            int cx = c % chunks.countX, cy = c / chunks.countX;
+            for(int y=cy*K; y<std::min(g.H, (cy+1)*K); ++y)
+                for(int x=cx*K; x<std::min(g.W, (cx+1)*K); ++x) fn(x, y);
+        };
+        auto forChunks = [&](auto&& body){
+            if(jobs) jobs->parallelFor(n, 64, body);
+            else     body((size_t)0, (size_t)n);
+        };
+        style = ts;
+        for(auto* b : { &floors, &walls, &goals }) b->start.assign(n + 1, 0);
+        forChunks([&](size_t first, size_t last){
+            for(size_t c=first; c<last; ++c){
+                GLsizei f = 0, w = 0, gl = 0;
+                forTiles((int)c, [&](int x, int y){ ++f; w += g.wallAt(x, y); gl += g.isGoal({x, y}); });
+                floors.start[c+1] = f; walls.start[c+1] = w; goals.start[c+1] = gl;
             }
+        });
+        for(auto* b : { &floors, &walls, &goals }){
+            for(int c=0; c<n; ++c) b->start[c+1] += b->start[c];
+            b->ib.data.resize((size_t)b->start[n]);
         }
+        forChunks([&](size_t first, size_t last){
+            for(size_t c=first; c<last; ++c){
+                InstanceData* fl = floors.ib.data.data() + floors.start[c];
+                InstanceData* wl = walls.ib.data.data() + walls.start[c];
+                InstanceData* go = goals.ib.data.data() + goals.start[c];
+                forTiles((int)c, [&](int x, int y){
+                    // floor
+                    glm::vec3 pos = { (float)x, -0.01f, (float)y };
+                    if(ts.floorModel) *fl++ = { tileTransform(pos, {1.0f,0.02f,1.0f}), {0.5f,0.5f,0.5f} };
+                    else           *fl++ = { tileTransform(pos, {1,0.05f,1}), {0.2f,0.25f,0.3f} };
+                    // walls
+                    if(g.wallAt(x, y)){
+                        glm::vec3 wpos = { (float)x, 0.5f, (float)y };
+                        if(ts.wallModel) *wl++ = { tileTransform(wpos, glm::vec3(0.2f)), {0.5f,0.5f,0.55f} };
+                        else          *wl++ = { tileTransform(wpos, {1,1,1}), {0.45f,0.45f,0.5f} };
+                    }
+                    if(g.isGoal({x, y}))
+                        *go++ = { tileTransform(glm::vec3(x, 0.01f, y), {0.2f,0.02f,0.2f}), {0.9f,0.85f,0.2f} };
+                });
+            }
+        });
+        visible.assign(n, 1);
     }
-
-    // ขนาดคอลลิเดอร์ (half extents) — ปรับเล็กลงให้เดิน/เลาะมุมง่ายขึ้น
-    constexpr float PLAYER_HALF = 0.38f; // เดิม 0.45f
-    constexpr float BOX_HALF = 0.40f; // เดิม 0.45f (ยังเกือบเต็มช่อง กันลอดซอก)
-
-    // 2) ตั้งคอลลิเดอร์ผู้เล่น
-    gPlayerEnt.box.center = glm::vec2(gGrid.player.x, gGrid.player.y);
-    gPlayerEnt.box.half = glm::vec2(PLAYER_HALF, PLAYER_HALF);
-    gPlayerEnt.world = glm::vec3(gGrid.player.x, 0, gGrid.player.y);
-    gPlayerEnt.scale = 1.0f;
-
-    // 3) ตั้งคอลลิเดอร์กล่องตามเลเวล
-    gBoxEnts.clear();
-    gBoxEnts.reserve(gGrid.boxes.size());
-    for (auto& b : gGrid.boxes) {
-        Entity e;
-        e.box.center = glm::vec2(b.x, b.y);
-        e.box.half = glm::vec2(BOX_HALF, BOX_HALF);
-        e.world = glm::vec3(b.x, 0, b.y);
-        e.scale = 1.0f;
-        gBoxEnts.push_back(e);
+    // CPU side of a build() made elsewhere; the GL buffers stay, upload() next
+    void adopt(LevelBatches&& next){
+        for(auto [to, from] : { std::pair{ &floors, &next.floors }, std::pair{ &walls, &next.walls }, std::pair{ &goals, &next.goals } }){
+            to->start = std::move(from->start);
+            to->ib.data = std::move(from->ib.data);
+        }
+        visible = std::move(next.visible);
+        style = next.style;
+    }
+    // GL thread, after build() / adopt()
+    void upload(){
+        for(auto* b : { &floors, &walls, &goals }) b->ib.upload();
     }
 
-    // 4) depenetration สั้น ๆ กันซ้อนกำแพงตอนเริ่ม (ผู้เล่น/กล่อง)
-    auto depen = [&](AABB& a) {
-        for (int it = 0; it < 4; ++it) {
-            bool any = false;
-            for (const auto& w : gStaticWalls) {
-                glm::vec2 aMin = a.center - a.half, aMax = a.center + a.half;
-                glm::vec2 bMin = w.center - w.half, bMax = w.center + w.half;
-                bool overlap = !(aMax.x < bMin.x || aMin.x > bMax.x || aMax.y < bMin.y || aMin.y > bMax.y);
-                if (overlap) {
-                    float ox = std::min(aMax.x - bMin.x, bMax.x - aMin.x);
-                    float oz = std::min(aMax.y - bMin.y, bMax.y - aMin.y);
-                    if (ox < oz) a.center.x += (a.center.x < w.center.x ? -ox : +ox) * 1.001f;
-                    else         a.center.y += (a.center.y < w.center.y ? -oz : +oz) * 1.001f;
-                    any = true;
+    // frustum test for every chunk; fills visible and stats, and the LOD
+    // input of each visible floor/wall chunk so the draws only read it
+    void cull(const TileChunks& chunks, const glm::mat4& viewProj, const Camera& cam, float viewportH, JobSystem& jobs){
+        const Frustum f = Frustum::fromMatrix(viewProj);
+        const int n = chunks.size();
+        visible.resize(n);
+        floors.pixelsPerUnit.resize(n);
+        walls.pixelsPerUnit.resize(n);
+        std::atomic<size_t> shown{0}, drawn{0}, culled{0};
+        jobs.parallelFor(n, 256, [&](size_t first, size_t last){
+            shown += cullBoxes(f, chunks.bounds, visible, first, last);
+            size_t d = 0, h = 0;
+            for(size_t c=first; c<last; ++c){
+                for(auto* b : { &floors, &walls, &goals }){
+                    size_t k = (size_t)(b->start[c+1] - b->start[c]);
+                    (visible[c] ? d : h) += k;
+                }
+                if(!visible[c]) continue;
+                for(auto* b : { &floors, &walls }){
+                    float best = 0.0f;
+                    for(GLsizei i=b->start[c]; i<b->start[c+1]; ++i)
+                        best = std::max(best, instancePixelsPerUnit(b->ib.data[(size_t)i], cam, viewportH));
+                    b->pixelsPerUnit[c] = best;
                 }
             }
-            if (!any) break;
-        }
-        };
-    depen(gPlayerEnt.box);
-    for (auto& e : gBoxEnts) depen(e.box);
-
-    // 5) รีเซ็ตสถานะการเคลื่อน
-    gPlayerWorld = glm::vec3(gPlayerEnt.box.center.x, 0, gPlayerEnt.box.center.y);
-    gMoveT = 1.0f;
-    gDir = { 0,0 };
-    gWinTimer = 0.0f;
-}
-
-
-// พยายามขยับ player ด้วย deltaGrid (เช่น {+1,0} หรือ {0,-1}) แบบต่อเนื่อง
-void physicsTryMovePlayer(glm::ivec2 dir) {
-    const float speed = 1.0f;                 // 1 tile ต่อครั้ง
-    glm::vec2 delta = glm::vec2(dir.x, dir.y) * speed;
-
-    // 1) player vs walls (slide)
-    glm::vec2 hitN{ 0,0 };
-    moveAndCollide(gPlayerEnt.box, delta, gStaticWalls, &hitN);
-
-    // 2) ตรวจชนกับ boxes แบบต่อเนื่อง:
-    //    ลอง sweep กับแต่ละกล่อง ถ้าชน เราจะ "ผลัก" กล่องต่อไปในทิศเดียวกัน
-    //    โดยกล่องจะต้อง sweep ผ่านกำแพง/กล่องอื่นได้ (ถ้าไม่ได้ → บล็อก player)
-    for (size_t i = 0; i < gBoxEnts.size(); ++i) {
-        SweepHit h = sweepAABB(gPlayerEnt.box, glm::vec2(0), gBoxEnts[i].box);
-        // h.toi == 0 แปลว่าทับซ้อนอยู่พอดี ให้ตรวจเฉพาะเมื่อผู้เล่นพยายามเข้าไปทับ
+            drawn += d; culled += h;
+        });
+        stats = {};
+        stats.chunksVisible = (int)shown;
+        stats.chunksCulled = n - (int)shown;
+        stats.tilesDrawn = drawn;
+        stats.tilesCulled = culled;
     }
 
-    // ทางที่ง่ายกว่า: ลองเคลื่อน player เล็ก ๆ ในทิศ dir ทีละแกน พร้อมทดสอบชนกับ box ด้วย sweep
-    // เพื่อให้ push ทำงานชัวร์แบบ discrete step (1 tile) แต่ยังคงเป็น AABB จริง
-}
-
-// Helper: ลองผลักกล่อง j ด้วย delta; คืน true ถ้าผ่าน (อัปเดตตำแหน่ง), false ถ้าติด
-bool tryMoveBox(size_t j, glm::vec2 delta, glm::vec2* movedOut) {
-    glm::vec2 old = gBoxEnts[j].box.center;
-
-    glm::vec2 n;
-    moveAndCollide(gBoxEnts[j].box, delta, gStaticWalls, &n);
-
-    // ห้ามชนกล่องอื่น -> ถ้าชน revert
-    for (size_t k = 0; k < gBoxEnts.size(); ++k) {
-        if (k == j) continue;
-        auto& A = gBoxEnts[j].box;
-        auto& B = gBoxEnts[k].box;
-        glm::vec2 aMin = A.center - A.half, aMax = A.center + A.half;
-        glm::vec2 bMin = B.center - B.half, bMax = B.center + B.half;
-        bool overlap = !(aMax.x<bMin.x || aMin.x>bMax.x || aMax.y<bMin.y || aMin.y>bMax.y);
-        if (overlap) {
-            gBoxEnts[j].box.center = old;     // << รีเวิร์ต
-            if (movedOut) *movedOut = glm::vec2(0);
-            return false;
+    // calls fn(first, count, pixelsPerUnit) for each run of consecutive
+    // visible chunks; pixelsPerUnit is the largest of the run's chunks (0 for
+    // batches cull() keeps none for)
+    template<class Fn>
+    void forVisibleRuns(const ChunkedBatch& b, Fn&& fn) const {
+        const int n = (int)visible.size();
+        const bool lod = (int)b.pixelsPerUnit.size() == n;
+        for(int c=0; c<n; ){
+            if(!visible[c]){ ++c; continue; }
+            int e = c;
+            float ppu = 0.0f;
+            for(; e < n && visible[e]; ++e) if(lod) ppu = std::max(ppu, b.pixelsPerUnit[e]);
+            GLsizei first = b.start[c], count = b.start[e] - first;
+            if(count > 0) fn(first, count, ppu);
+            c = e;
         }
     }
 
-    if (movedOut) *movedOut = gBoxEnts[j].box.center - old; // ระยะที่ขยับจริง (อาจถูก clip)
-    return true;
-}
-
-// เวอร์ชันง่าย (แนะนำเริ่มจากอันนี้): ขยับแบบ "หนึ่งช่อง" แต่ทดสอบชนแบบ AABB จริง
-void tryMoveDiscreteAABB(glm::ivec2 d) {
-    glm::vec2 targetDelta = glm::vec2(d.x, d.y);  // 1 ช่อง
-
-    // ถ้าช่องหน้ามีกล่อง → ทดลองผลักกล่องก่อน
-    // สแกนหา box ที่อยู่หน้า player (AABB overlap หลัง apply delta เล็ก ๆ)
-    int hitBox = -1;
-    AABB probe = gPlayerEnt.box; probe.center += targetDelta;
-    for (size_t i = 0; i < gBoxEnts.size(); ++i) {
-        // ทดสอบ overlap AABB simple
-        glm::vec2 aMin = probe.center - probe.half, aMax = probe.center + probe.half;
-        glm::vec2 bMin = gBoxEnts[i].box.center - gBoxEnts[i].box.half, bMax = gBoxEnts[i].box.center + gBoxEnts[i].box.half;
-        bool overlap = !(aMax.x < bMin.x || aMin.x > bMax.x || aMax.y < bMin.y || aMin.y > bMax.y);
-        if (overlap) { hitBox = (int)i; break; }
+    // reads only the crates' transform and colour arrays; upload on the
+    // GL thread afterwards (boxes.upload(GL_STREAM_DRAW))
+    void fillBoxes(const EntityStore& crates, const Assets& a, JobSystem& jobs){
+        boxes.data.resize(crates.size());
+        jobs.parallelFor(crates.size(), 4096, [&](size_t first, size_t last){
+            for(size_t i=first;i<last;++i){
+                glm::vec3 pos = crates.world[i] + glm::vec3(0, 0.5f, 0);
+                float s = crates.scale[i];
+                if(a.hasBox) boxes.data[i] = { tileTransform(pos, glm::vec3(0.15f * s)), crates.color[i] };
+                else         boxes.data[i] = { tileTransform(pos, glm::vec3(s)), {0.7f,0.4f,0.2f} };
+            }
+        });
     }
+};
 
-    if (hitBox >= 0) {
-        // ลองขยับกล่องก่อน
-        glm::vec2 moved;
-        if (tryMoveBox((size_t)hitBox, targetDelta, &moved)) {
-            // กล่องไปได้ → ค่อยขยับผู้เล่น
-            glm::vec2 n;
-            moveAndCollide(gPlayerEnt.box, moved, gStaticWalls, &n);
-        }
-        else {
-            // กล่องไปไม่ได้ → ผู้เล่นไม่ไป
-        }
-    }
-    else {
-        // ขยับผู้เล่นชนกำแพงพร้อม slide
-        glm::vec2 n; moveAndCollide(gPlayerEnt.box, targetDelta, gStaticWalls, &n);
-    }
+// Globals
+Camera gCam;
+Assets gAssets;
+Simulation gSim;
+LevelBatches gBatches;
+std::atomic<TileStyle> gTileStyle;  // gAssets.tileStyle() for the level pipeline worker, set on the main thread
+uint8_t gPendingCommands = 0;   // SimInput::Reload / Restart, until a tick consumes them
+
+// LOD input for a whole batch (crates): the instance with the most pixels per
+// model unit (nearest, largest scale) decides, since they share one draw
+// call; with `jobs` the scan is split across threads
+static float batchPixelsPerUnit(const InstanceBuffer& ib, JobSystem* jobs = nullptr){
+    auto scan = [&](size_t b, size_t e){
+        float best = 0.0f;
+        for(size_t i=b; i<e; ++i) best = std::max(best, instancePixelsPerUnit(ib.data[i], gCam, (float)SCR_H));
+        return best;
+    };
+    if(!jobs || ib.data.empty()) return scan(0, ib.data.size());
+    std::atomic<float> best{0.0f};
+    jobs->parallelFor(ib.data.size(), 4096, [&](size_t b, size_t e){
+        float m = scan(b, e), cur = best.load();
+        while(m > cur && !best.compare_exchange_weak(cur, m)) {}
+    });
+    return best;
 }
 
-
 void framebuffer_size_callback(GLFWwindow*, int w, int h){ SCR_W=w; SCR_H=h; glViewport(0,0,w,h); gCam.aspect = float(w)/float(h); }
 
 void key_callback(GLFWwindow* win, int key, int sc, int action, int mods) {
+    // undo/redo one push per press, repeating while held
+    if (action == GLFW_PRESS || action == GLFW_REPEAT) {
+        if (key == GLFW_KEY_Z) gPendingCommands |= SimInput::Undo;
+        if (key == GLFW_KEY_Y) gPendingCommands |= SimInput::Redo;
+    }
     if (action == GLFW_PRESS) {
         if (key == GLFW_KEY_ESCAPE) glfwSetWindowShouldClose(win, 1);
 
+        // level commands go through the next tick so recordings see them
         if (key == GLFW_KEY_R) {      
-            loadCurrentLevel();
+            gPendingCommands |= SimInput::Reload;
         }
 
-        if (key == GLFW_KEY_ENTER && gAllCleared) {
-            gLevelIndex = 0;
-            gAllCleared = false;
-            loadCurrentLevel();
+        if (key == GLFW_KEY_ENTER && gSim.allCleared) {
+            gPendingCommands |= SimInput::Restart;
         }
 
         if (key == GLFW_KEY_1) gCam.topDown = false;
         if (key == GLFW_KEY_2) gCam.topDown = true;
 
-        //if (gMoveT >= 1.0f && !gAllCleared) {
+        //if (gSim.moveT >= 1.0f && !gSim.allCleared) {
         //    glm::ivec2 d{ 0,0 };
 
         //    if (key == GLFW_KEY_W || key == GLFW_KEY_UP)    d = { 0, -1 };
@@ -356,121 +328,43 @@ void key_callback(GLFWwindow* win, int key, int sc, int action, int mods) {
         //    if (key == GLFW_KEY_A || key == GLFW_KEY_LEFT)  d = { -1, 0 };
         //    if (key == GLFW_KEY_D || key == GLFW_KEY_RIGHT) d = { 1, 0 };
         //    if (d != glm::ivec2{ 0,0 }) {
-        //        tryMoveDiscreteAABB(d);     // <— ใช้อันใหม่
+        //        gSim.tryMoveDiscreteAABB(d);     // <— ใช้อันใหม่
         //        // อัปเดตทิศเพื่อหมุนตัวละคร
-        //        gDir = d;
-        //        gMoveAnimStart = gPlayerWorld;
-        //        gMoveAnimEnd = glm::vec3(gPlayerEnt.box.center.x, 0, gPlayerEnt.box.center.y);
-        //        gMoveT = 0.0f;
+        //        gSim.dir = d;
+        //        gSim.moveAnimStart = gSim.playerWorld();
+        //        gSim.moveAnimEnd = glm::vec3(gSim.playerBox().center.x, 0, gSim.playerBox().center.y);
+        //        gSim.moveT = 0.0f;
         //    }
         //}
     }
 }
 
-
-bool cellFree(glm::ivec2 p){
-    if(gGrid.isWall(p)) return false;
-    int idx=-1; if(gGrid.occupiedByBox(p, &idx)) return false;
-    return true;
+// keyboard -> held directions for the simulation tick
+SimInput pollInput(GLFWwindow* win) {
+    SimInput in;
+    if (glfwGetKey(win, GLFW_KEY_D) == GLFW_PRESS || glfwGetKey(win, GLFW_KEY_RIGHT) == GLFW_PRESS) in.buttons |= SimInput::Right;
+    if (glfwGetKey(win, GLFW_KEY_A) == GLFW_PRESS || glfwGetKey(win, GLFW_KEY_LEFT) == GLFW_PRESS) in.buttons |= SimInput::Left;
+    if (glfwGetKey(win, GLFW_KEY_S) == GLFW_PRESS || glfwGetKey(win, GLFW_KEY_DOWN) == GLFW_PRESS) in.buttons |= SimInput::Down;
+    if (glfwGetKey(win, GLFW_KEY_W) == GLFW_PRESS || glfwGetKey(win, GLFW_KEY_UP) == GLFW_PRESS) in.buttons |= SimInput::Up;
+    return in;
 }
 
-void tryMove(glm::ivec2 d){
-    glm::ivec2 dest = gGrid.player + d;
-    if(gGrid.isWall(dest)) return;
-    int idx=-1;
-    if(gGrid.occupiedByBox(dest, &idx)){
-        glm::ivec2 beyond = dest + d;
-        if(cellFree(beyond)){
-            gGrid.boxes[idx] = beyond;
-            // move player into dest
-            gGrid.player = dest;
-        } else return; // blocked
-    } else {
-        gGrid.player = dest;
+int main(int argc, char** argv){
+    const auto appStart = std::chrono::steady_clock::now();
+    //   --threads N    job system size, frame thread included (default: all cores)
+    //   --job-stats    print the frame job timings every 300 frames
+    //   --record F     write every simulation tick to replay file F on exit
+    //   levels...      level files or specs (pack.xsb = all its levels, pack.xsb#12)
+    int threads = 0;
+    bool jobStats = false;
+    const char* recordPath = nullptr;
+    std::vector<std::string> levelArgs;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--threads") && i + 1 < argc) threads = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--job-stats")) jobStats = true;
+        else if (!std::strcmp(argv[i], "--record") && i + 1 < argc) recordPath = argv[++i];
+        else if (argv[i][0] != '-' && !LevelCollection::expand(argv[i], levelArgs)) std::cerr << "cannot open " << argv[i] << "\n";
     }
-    gDir = d;
-    gMoveAnimStart = gPlayerWorld;
-    gMoveAnimEnd   = glm::vec3(gGrid.player.x, 0, gGrid.player.y);
-    gMoveT = 0.0f;
-}
-
-void handleInputAndMove(GLFWwindow* win, float dt) {
-    // อ่านทิศทางจากหลายปุ่มพร้อมกัน
-    glm::vec2 in(0.0f);
-    if (glfwGetKey(win, GLFW_KEY_D) == GLFW_PRESS || glfwGetKey(win, GLFW_KEY_RIGHT) == GLFW_PRESS) in.x += 1.0f;
-    if (glfwGetKey(win, GLFW_KEY_A) == GLFW_PRESS || glfwGetKey(win, GLFW_KEY_LEFT) == GLFW_PRESS) in.x -= 1.0f;
-    if (glfwGetKey(win, GLFW_KEY_S) == GLFW_PRESS || glfwGetKey(win, GLFW_KEY_DOWN) == GLFW_PRESS) in.y += 1.0f; // +Z = ลง
-    if (glfwGetKey(win, GLFW_KEY_W) == GLFW_PRESS || glfwGetKey(win, GLFW_KEY_UP) == GLFW_PRESS) in.y -= 1.0f; // -Z = ขึ้น
-
-    if (in.x == 0.0f && in.y == 0.0f) return;
-
-    // นอร์มอลไลซ์ทิศทาง + ตั้งความเร็วหน่วย "ช่องต่อวินาที"
-    float len = glm::length(in);
-    if (len > 0.0f) in /= len;
-
-    const float speed = 5.0f; // เดิน ~5 ช่อง/วินาที
-    glm::vec2 delta = in * speed * dt;
-
-    // --- ถ้า "มีลังอยู่ด้านหน้า" ให้ลองผลักแบบ step ขนาด 1 ช่อง (ยังคงพฤติกรรม Sokoban) ---
-    // เฉพาะกรณีที่ผู้เล่นกดเกือบขนานแกนหลัก (กันการผลักเฉียง)
-    glm::vec2 axis = (std::abs(in.x) > std::abs(in.y)) ? glm::vec2((in.x > 0) ? 1 : -1, 0) : glm::vec2(0, (in.y > 0) ? 1 : -1);
-
-    // โพรบหาลังด้านหน้า (ใช้ AABB overlap ง่าย ๆ)
-    int hitBox = -1;
-    {
-        AABB probe = gPlayerEnt.box;
-        probe.center += axis * 0.6f; // โพรบไปข้างหน้าเล็กน้อย
-        for (size_t i = 0; i < gBoxEnts.size(); ++i) {
-            glm::vec2 aMin = probe.center - probe.half, aMax = probe.center + probe.half;
-            glm::vec2 bMin = gBoxEnts[i].box.center - gBoxEnts[i].box.half, bMax = gBoxEnts[i].box.center + gBoxEnts[i].box.half;
-            bool overlap = !(aMax.x < bMin.x || aMin.x > bMax.x || aMax.y < bMin.y || aMin.y > bMax.y);
-            if (overlap) { hitBox = (int)i; break; }
-        }
-    }
-
-    // axis = ทิศผลักหลัก (1,0) หรือ (0,1) ตามที่คุณคำนวณไว้
-    glm::vec2 movedBox(0);
-
-    // เคสเจอกล่องข้างหน้า
-    if (hitBox >= 0) {
-        glm::vec2 pushDelta = axis * (speed * dt);
-
-        if (tryMoveBox((size_t)hitBox, pushDelta, &movedBox) && (movedBox.x != 0 || movedBox.y != 0)) {
-            // กล่องขยับได้ -> ผู้เล่นตามไป "เท่าที่กล่องไปจริง"
-            glm::vec2 n; moveAndCollide(gPlayerEnt.box, movedBox, gStaticWalls, &n);
-        }
-        else {
-            // กล่องขยับไม่ได้ -> ผู้เล่นไม่ดันซ้อน ให้ slide ด้วยคอมโพเนนต์ที่ไม่ดันเข้ากล่อง
-            float vn = glm::dot(delta, axis);            // คอมโพเนนต์ที่ดันเข้ากล่อง
-            glm::vec2 deltaSlide = (vn > 0) ? (delta - axis * vn) : delta;  // ตัดเฉพาะถ้ากำลังดันเข้า
-            glm::vec2 n; moveAndCollide(gPlayerEnt.box, deltaSlide, gStaticWalls, &n);
-        }
-    }
-    else {
-        // ไม่มีลัง -> เดินปกติ (มี slide vs กำแพงอยู่แล้ว)
-        glm::vec2 n; moveAndCollide(gPlayerEnt.box, delta, gStaticWalls, &n);
-    }
-
-    // กันผู้เล่นซ้อนกล่อง (depenetration สั้น ๆ)
-    for (auto& box : gBoxEnts) {
-        glm::vec2 aMin = gPlayerEnt.box.center - gPlayerEnt.box.half, aMax = gPlayerEnt.box.center + gPlayerEnt.box.half;
-        glm::vec2 bMin = box.box.center - box.box.half, bMax = box.box.center + box.box.half;
-        bool overlap = !(aMax.x<bMin.x || aMin.x>bMax.x || aMax.y<bMin.y || aMin.y>bMax.y);
-        if (overlap) {
-            // ดันผู้เล่นออกจากกล่องทางแกนซ้อนน้อยกว่า
-            float ox = std::min(aMax.x - bMin.x, bMax.x - aMin.x);
-            float oz = std::min(aMax.y - bMin.y, bMax.y - aMin.y);
-            if (ox < oz) gPlayerEnt.box.center.x += (gPlayerEnt.box.center.x < box.box.center.x ? -ox : +ox) * 1.001f;
-            else        gPlayerEnt.box.center.y += (gPlayerEnt.box.center.y < box.box.center.y ? -oz : +oz) * 1.001f;
-        }
-    }
-
-
-    // อัปเดตทิศเพื่อหมุนโมเดล
-    gDir = glm::ivec2((in.x > 0.1f) - (in.x < -0.1f), (in.y > 0.1f) - (in.y < -0.1f));
-}
-
-int main(){
     if(!glfwInit()){ std::cerr<<"glfw init failed\n"; return 1; }
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR,3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR,3);
@@ -489,156 +383,267 @@ int main(){
     std::ifstream vf("shaders/basic.vert"); std::string vsrc((std::istreambuf_iterator<char>(vf)), {});
     std::ifstream ff("shaders/basic.frag"); std::string fsrc((std::istreambuf_iterator<char>(ff)), {});
     Shader sh(vsrc, fsrc);
-
-    // Load assets
-    gAssets.load();
+    sh.bindUniformBlock("Frame", FrameUniforms::kBinding);
+    const UniformLoc uModel     = sh.uniform("uModel");
+    const UniformLoc uColor     = sh.uniform("uColor");
+    const UniformLoc uInstanced = sh.uniform("uInstanced");
+    sh.use();
+    sh.setBool("uHasTexture", false);
+
+    UniformRing frameRing;
+    frameRing.init(sizeof(FrameUniforms), FrameUniforms::kBinding);
+    std::cout << "Frame UBO: " << (frameRing.persistent() ? "persistent mapped ring" : "glBufferSubData ring") << "\n";
+
+    // Load assets in the background; cubes stand in until each model is uploaded
+    AssetLoader loader;
+    gAssets.load(loader);
+    bool firstFrameShown = false;
 
     // Load level
-    loadCurrentLevel();
-    gPlayerWorld = glm::vec3(gGrid.player.x, 0, gGrid.player.y);
+    gSim.levels = levelArgs;
+    if (gSim.levels.empty()) gSim.levels = {
+        "assets/levels/level01.txt",
+        "assets/levels/level02.txt",
+        "assets/levels/level03.txt"
+    };
+    // the next level's tile batches are built on the level pipeline worker
+    // too; a model arriving in between makes the frame rebuild them instead
+    gTileStyle.store(gAssets.tileStyle());
+    gSim.prepareRender = [](const PreparedLevel& L) -> std::shared_ptr<void> {
+        auto b = std::make_shared<LevelBatches>();
+        b->build(L.grid, L.chunks, gTileStyle.load(), nullptr);
+        return b;
+    };
+    gSim.loadCurrentLevel();
+    ReplayRecorder recorder;
+    if (recordPath) {
+        recorder.begin(gSim);
+        gSim.recorder = &recorder;
+    }
+    int shownLevel = gSim.levelIndex;
+    int shownChunks = -1;
+    DeadlockAnalyzer::Deadlock shownDeadlock;
 
     glEnable(GL_DEPTH_TEST);
 
+    // SOKOBAN_PROFILE builds only: trace.json opens in chrome://tracing / Perfetto
+    PROF_BEGIN_SESSION("trace.json", "frame_times.txt");
+    PROF_GPU_TIMERS(gpuTimers);
+
+    // CPU side of a frame as a job graph; everything touching GL runs on
+    // this thread after frameGraph.run() returns
+    JobSystem jobs(threads);
+    std::cout << "Jobs: " << jobs.threadCount() << " threads\n";
+    struct FramePrep {
+        float dt = 0.0f;
+        SimInput input;
+        FrameUniforms frame;
+        int ticks = 0;
+        bool staticBuilt = false;       // static batches need an upload
+        bool levelSwitched = false;     // a new level is shown this frame
+        bool tilesAdopted = false;      // its tiles were prepared ahead
+        float boxesPixelsPerUnit = 0.0f;
+    } prep;
+    JobGraph frameGraph;
+    const auto jSim = frameGraph.add("simulation", [&]{
+        // fixed-step simulation, render between the last two ticks
+        prep.ticks = gSim.advance(prep.dt, prep.input);
+    });
+    const auto jSync = frameGraph.add("sync world", [&]{ gSim.syncWorld(gSim.alpha(), &jobs); }, { jSim });
+    const auto jCamera = frameGraph.add("camera", [&]{
+        // camera follow
+        gCam.follow(gSim.playerWorld());
+        prep.frame.view = gCam.view();
+        prep.frame.proj = gCam.proj();
+        prep.frame.camPos = glm::vec4(gCam.pos, 1.0f);
+        // dir light
+        prep.frame.lightDir = { -0.5f, -1.0f, -0.3f, 0.0f };
+        prep.frame.lightColor = { 1.0f, 1.0f, 1.0f, 0.0f };
+    }, { jSync });
+    const auto jStatic = frameGraph.add("static batches", [&]{
+        prep.levelSwitched = gBatches.serial != gSim.levelSerial;
+        prep.staticBuilt = prep.levelSwitched || gBatches.assetVersion != gAssets.version;
+        prep.tilesAdopted = false;
+        if (prep.staticBuilt) {
+            auto ready = std::static_pointer_cast<LevelBatches>(gSim.preparedRender);
+            prep.tilesAdopted = prep.levelSwitched && ready && ready->style == gAssets.tileStyle();
+            if (prep.tilesAdopted) gBatches.adopt(std::move(*ready));
+            else                   gBatches.build(gSim.grid, gSim.chunks, gAssets.tileStyle(), &jobs);
+            gSim.preparedRender.reset();
+            gBatches.serial = gSim.levelSerial;
+            gBatches.assetVersion = gAssets.version;
+        }
+    }, { jSim });
+    // static tiles: only chunks inside the view frustum, with their LOD input
+    frameGraph.add("cull", [&]{ gBatches.cull(gSim.chunks, prep.frame.proj * prep.frame.view, gCam, (float)SCR_H, jobs); }, { jCamera, jStatic });
+    // boxes (ใช้ตำแหน่งจากฟิสิกส์)
+    const auto jCrates = frameGraph.add("crate instances", [&]{ gBatches.fillBoxes(gSim.crates, gAssets, jobs); }, { jSync });
+    frameGraph.add("crate lod", [&]{ prep.boxesPixelsPerUnit = batchPixelsPerUnit(gBatches.boxes, &jobs); }, { jCrates, jCamera });
+    uint64_t frameNo = 0;
 
     while(!glfwWindowShouldClose(win)){
-        glfwPollEvents();
+        PROF_GPU_FRAME(gpuTimers);
+        SimInput input;
+        {
+            PROF_ZONE("input");
+            glfwPollEvents();
+            input = pollInput(win);
+            input.buttons |= gPendingCommands;
+        }
 
         static double lastT = glfwGetTime();
         double now = glfwGetTime();
-        float dt = float(now - lastT);
+        prep.dt = float(now - lastT);
+        prep.input = input;
         lastT = now;
 
-        handleInputAndMove(win, dt);
-
-        // animate movement
-       // sync world from collider (ให้อนิเมชันไปทางเดียวกัน)
-
-        glm::vec3 playerGoal = glm::vec3(gPlayerEnt.box.center.x, 0, gPlayerEnt.box.center.y);
-        gPlayerWorld = glm::vec3(gPlayerEnt.box.center.x, 0, gPlayerEnt.box.center.y);
-        for (auto& e : gBoxEnts) e.world = glm::vec3(e.box.center.x, 0, e.box.center.y);
-
-
-        // camera follow
-        gCam.follow(gPlayerWorld);
+        {
+            PROF_ZONE("frame jobs");
+            frameGraph.run(jobs);
+        }
+        if (prep.ticks > 0) gPendingCommands = 0;
+        if (jobStats && ++frameNo % 300 == 0) frameGraph.print(stdout);
 
         glClearColor(0.07f,0.08f,0.10f,1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         sh.use();
-        glm::mat4 V = gCam.view();
-        glm::mat4 P = gCam.proj();
-        sh.setMat4("uView", &V[0][0]);
-        sh.setMat4("uProj", &P[0][0]);
-        sh.setVec3("uCamPos", gCam.pos.x, gCam.pos.y, gCam.pos.z);
-        // dir light
-        sh.setVec3("uLightDir", -0.5f, -1.0f, -0.3f);
-        sh.setVec3("uLightColor", 1.0f, 1.0f, 1.0f);
-        sh.setBool("uHasTexture", false);
+        frameRing.push(&prep.frame);
 
         auto drawCubeColored = [&](glm::vec3 pos, glm::vec3 scl, glm::vec3 color){
             glm::mat4 M(1.0f);
             M = glm::translate(M, pos);
             M = glm::scale(M, scl);
-            sh.setMat4("uModel",&M[0][0]);
-            sh.setColor("uColor", color.x, color.y, color.z);
+            sh.setMat4(uModel,&M[0][0]);
+            sh.setColor(uColor, color.x, color.y, color.z);
             gAssets.cube.draw();
         };
 
-        // Draw grid: floors & walls
-        for(int y=0;y<gGrid.H;++y){
-            for(int x=0;x<gGrid.W;++x){
-                glm::ivec2 p{x,y};
-                // floor
-                glm::vec3 pos = { (float)x, -0.01f, (float)y };
-                if(gAssets.hasFloor){
-                    glm::mat4 M = glm::translate(glm::mat4(1.0f), pos) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.02f, 1.0f));
-                    sh.setMat4("uModel", &M[0][0]);
-                    sh.setColor("uColor", 0.5f,0.5f,0.5f);
-                    gAssets.floor.draw();
-                } else {
-                    drawCubeColored(pos, {1,0.05f,1}, {0.2f,0.25f,0.3f});
-                }
-                // walls (from raw map)
-                int ry = gGrid.H-1-y;
-                if(ry>=0 && ry<gGrid.H && x<(int)gGrid.raw[ry].size() && gGrid.raw[ry][x]=='#'){
-                    glm::vec3 wpos = { (float)x, 0.5f, (float)y };
-                    if(gAssets.hasWall){
-                        glm::mat4 M = glm::translate(glm::mat4(1.0f), wpos);
-                        M = glm::scale(M, glm::vec3(0.2f));
-                        sh.setMat4("uModel", &M[0][0]);
-                        sh.setColor("uColor", 0.5f,0.5f,0.55f);
-                        gAssets.wall.draw();
-                    } else {
-                        drawCubeColored(wpos, {1,1,1}, {0.45f,0.45f,0.5f});
-                    }
-                }
-            }
+        // tiles + crates: one instanced draw per batch
+        {
+            PROF_ZONE("batch upload");
+            if (prep.staticBuilt) gBatches.upload();
+            gBatches.boxes.upload(GL_STREAM_DRAW);
         }
 
-        // goals
-        for(auto& g: gGrid.goals){
-            drawCubeColored(glm::vec3(g.x, 0.01f, g.y), {0.2f,0.02f,0.2f}, {0.9f,0.85f,0.2f});
+        sh.setBool(uInstanced, true);
+        {
+            PROF_ZONE("draw tiles");
+            PROF_GPU_ZONE(gpuTimers, "draw tiles");
+            gBatches.forVisibleRuns(gBatches.floors, [&](GLsizei first, GLsizei count, float ppu){
+                gAssets.drawModelOrCubeInstanced(gAssets.floor, gAssets.hasFloor, gBatches.floors.ib, ppu, first, count);
+            });
+            gBatches.forVisibleRuns(gBatches.walls, [&](GLsizei first, GLsizei count, float ppu){
+                gAssets.drawModelOrCubeInstanced(gAssets.wall, gAssets.hasWall, gBatches.walls.ib, ppu, first, count);
+            });
+            gBatches.forVisibleRuns(gBatches.goals, [&](GLsizei first, GLsizei count, float){
+                gAssets.cube.drawInstanced(gBatches.goals.ib, 0, first, count);
+            });
         }
-
-        // boxes
-        // boxes (ใช้ตำแหน่งจากฟิสิกส์)
-        for (auto& e : gBoxEnts) {
-            glm::vec3 pos = e.world + glm::vec3(0, 0.5f, 0);
-            if (gAssets.hasBox) {
-                glm::mat4 M = glm::translate(glm::mat4(1.0f), pos);
-                M = glm::scale(M, glm::vec3(0.15f));
-                sh.setMat4("uModel", &M[0][0]);
-                sh.setColor("uColor", 0.8f, 0.6f, 0.3f);
-                gAssets.box.draw();
-            }
-            else {
-                drawCubeColored(pos, { 1,1,1 }, { 0.7f,0.4f,0.2f });
-            }
+        {
+            PROF_ZONE("draw crates");
+            PROF_GPU_ZONE(gpuTimers, "draw crates");
+            gAssets.drawModelOrCubeInstanced(gAssets.box, gAssets.hasBox, gBatches.boxes, prep.boxesPixelsPerUnit);
         }
-
+        sh.setBool(uInstanced, false);
 
         // player
         {
-            glm::vec3 pos = gPlayerWorld + glm::vec3(0,0.5f,0);
+            PROF_ZONE("draw player");
+            PROF_GPU_ZONE(gpuTimers, "draw player");
+            const uint32_t ps = gSim.actors.slot(gSim.player);
+            glm::vec3 pos = gSim.actors.world[ps] + glm::vec3(0,0.5f,0);
+            glm::vec3 tint = gSim.actors.color[ps];
             if(gAssets.hasPlayer){
                 glm::mat4 M = glm::translate(glm::mat4(1.0f), pos);
                 // Face movement direction
-                float rotY = std::atan2((float)gDir.y, -(float)gDir.x);
+                float rotY = std::atan2((float)gSim.dir.y, -(float)gSim.dir.x);
                 M = glm::rotate(M, rotY, glm::vec3(0, 1, 0));
                 M = glm::scale(M, glm::vec3(0.075f));
-                sh.setMat4("uModel",&M[0][0]);
-                sh.setColor("uColor", 0.2f,0.7f,0.8f);
-                gAssets.player.draw();
+                sh.setMat4(uModel,&M[0][0]);
+                sh.setColor(uColor, tint.x, tint.y, tint.z);
+                gAssets.player.draw(0.075f * gCam.pixelsPerUnit(pos, (float)SCR_H));
             } else {
-                drawCubeColored(pos, {1,1,1}, {0.2f,0.7f,0.8f});
+                drawCubeColored(pos, {1,1,1}, tint);
             }
         }
 
         // win text via clear color blink (simple)
         // ----- WIN / LEVEL PROGRESSION -----
-        if (winAABB()) {
+        // (ตัวนับเวลา/โหลดด่านถัดไปอยู่ใน Simulation::step แล้ว)
+        if (gSim.winAABB()) {
             float t = (float)glfwGetTime();
             glClearColor(0.0f, 0.35f + 0.25f * std::sin(t * 6.0f), 0.0f, 1.0f);
 
-            if (!gAllCleared) {
-                if (gLevelIndex < (int)gLevels.size() - 1) {
-                    gWinTimer += dt;
-                    glfwSetWindowTitle(win, "Level Cleared! Loading next...");
-                    if (gWinTimer >= 1.0f) {
-                        gLevelIndex++;
-                        loadCurrentLevel();
-                        glfwSetWindowTitle(win, ("Level " + std::to_string(gLevelIndex + 1)).c_str());
-                    }
-                }
-                else {
-                    gAllCleared = true;
-                }
+            if (!gSim.allCleared && gSim.levelIndex < (int)gSim.levels.size() - 1) {
+                glfwSetWindowTitle(win, "Level Cleared! Loading next...");
             }
         }
+        // level + culling counts, refreshed when either changes
+        const CullStats& cs = gBatches.stats;
+        // plus the first deadlock the analyser holds, until a push clears it
+        const auto& dls = gSim.deadlock.deadlocks();
+        const DeadlockAnalyzer::Deadlock shownNow = dls.empty() ? DeadlockAnalyzer::Deadlock{} : dls.front();
+        const bool deadlockChanged = shownNow.kind != shownDeadlock.kind || shownNow.cell != shownDeadlock.cell;
+        if (gSim.levelIndex != shownLevel || deadlockChanged || (cs.chunksVisible != shownChunks && !gSim.winAABB())) {
+            shownLevel = gSim.levelIndex;
+            shownChunks = cs.chunksVisible;
+            shownDeadlock = shownNow;
+            std::string title = "Level " + std::to_string(shownLevel + 1)
+                + " | chunks " + std::to_string(cs.chunksVisible) + "/" + std::to_string(cs.chunksVisible + cs.chunksCulled)
+                + " | tiles " + std::to_string(cs.tilesDrawn) + " drawn, " + std::to_string(cs.tilesCulled) + " culled";
+            if (shownNow.kind != DeadlockAnalyzer::Kind::None)
+                title += std::string(" | DEADLOCK (") + DeadlockAnalyzer::kindName(shownNow.kind) + " at "
+                    + std::to_string(shownNow.cell.x) + "," + std::to_string(shownNow.cell.y) + ") - Z to undo";
+            glfwSetWindowTitle(win, title.c_str());
+        }
+
 
+        frameRing.endFrame();
+        {
+            PROF_ZONE("swap");
+            glfwSwapBuffers(win);
+        }
 
-        glfwSwapBuffers(win);
+        if (prep.levelSwitched) {
+            // the hitch as seen on screen: the whole frame that switched levels
+            std::printf("[level] %d/%zu shown: frame %.2f ms, simulation %.2f ms (%s), tiles %s\n",
+                        gSim.levelIndex + 1, gSim.levels.size(), (glfwGetTime() - now) * 1000.0, gSim.lastLoad.hitchMs,
+                        gSim.lastLoad.prepared ? "prepared ahead" : "loaded on the spot",
+                        prep.tilesAdopted ? "prepared ahead" : "built in frame");
+        }
+        if (!firstFrameShown) {
+            firstFrameShown = true;
+            std::cout << "First frame: "
+                      << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - appStart).count() << " ms\n";
+        }
+        {
+            PROF_ZONE("asset upload");
+            // GL uploads for models the workers finished, ~2 ms per frame
+            if (!loader.idle() && loader.pump(2.0) > 0 && loader.idle()) {
+                // cold start = imports (cache misses), warm start = all hits
+                auto& st = mesh_cache::stats();
+                std::cout << "Models: all loaded in " << loader.totalLoadMs() << " ms ("
+                          << st.hits << " cached, " << st.misses << " imported)\n";
+                size_t gpu = 0, flt = 0;
+                for (const Model* m : { &gAssets.player, &gAssets.box, &gAssets.wall, &gAssets.floor }) {
+                    gpu += m->gpuBytes(); flt += m->floatBytes();
+                }
+                std::cout << "Models: " << gpu << " bytes on the GPU (" << flt << " as float vertices)\n";
+            }
+            gTileStyle.store(gAssets.tileStyle());
+        }
+        PROF_FRAME();
+    }
+    if (recordPath) {
+        if (recorder.replay.save(recordPath))
+            std::cout << "Replay: " << recorder.replay.ticks << " ticks -> " << recordPath << "\n";
+        else
+            std::cerr << "Replay: cannot write " << recordPath << "\n";
     }
+    PROF_GPU_DESTROY(gpuTimers);
+    PROF_END_SESSION();
+    frameRing.destroy();
     glfwTerminate();
     return 0;
 }
\ No newline at end of file
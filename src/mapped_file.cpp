@@ -0,0 +1,72 @@
+#include "mapped_file.h"
+#include <algorithm>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::open(const std::string& path){
+    close();
+#if defined(_WIN32)
+    HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(f == INVALID_HANDLE_VALUE) return false;
+    file = f;
+    LARGE_INTEGER sz{};
+    if(!GetFileSizeEx(f, &sz)){ close(); return false; }
+    if(sz.QuadPart == 0){ CloseHandle(f); file = nullptr; opened = true; return true; }
+    mapping = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(!mapping){ close(); return false; }
+    ptr = (const uint8_t*)MapViewOfFile((HANDLE)mapping, FILE_MAP_READ, 0, 0, 0);
+    if(!ptr){ close(); return false; }
+    len = (size_t)sz.QuadPart;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) return false;
+    struct stat st{};
+    if(fstat(fd, &st) != 0){ ::close(fd); return false; }
+    if(st.st_size == 0){ ::close(fd); opened = true; return true; }
+    void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);                                   // the mapping keeps the file alive
+    if(p == MAP_FAILED) return false;
+    ptr = (const uint8_t*)p;
+    len = (size_t)st.st_size;
+#endif
+    opened = true;
+    return true;
+}
+
+void MappedFile::close(){
+#if defined(_WIN32)
+    if(ptr) UnmapViewOfFile(ptr);
+    if(mapping) CloseHandle((HANDLE)mapping);
+    if(file) CloseHandle((HANDLE)file);
+    mapping = nullptr; file = nullptr;
+#else
+    if(ptr) munmap((void*)ptr, len);
+#endif
+    ptr = nullptr; len = 0; opened = false;
+}
+
+void MappedFile::prefetch(size_t offset, size_t bytes) const {
+    if(!ptr || offset >= len) return;
+    bytes = std::min(bytes, len - offset);
+    const size_t page = 4096;
+    size_t begin = offset / page * page;
+#if defined(_WIN32)
+    WIN32_MEMORY_RANGE_ENTRY range{ (PVOID)(ptr + begin), offset + bytes - begin };
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    madvise((void*)(ptr + begin), offset + bytes - begin, MADV_WILLNEED);
+#endif
+}
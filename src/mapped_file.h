@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+// Read-only memory map of a whole file. Pages come straight from the OS
+// cache; nothing is copied until the caller reads (or hands the pointer to GL).
+// An empty file opens as an empty view (size 0, no mapping) and is left to the
+// parsers to reject like any other short file. The OS calls live in
+// mapped_file.cpp so no platform header leaks into the includers.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path){ open(path); }
+    ~MappedFile(){ close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& o) noexcept { swap(o); }
+    MappedFile& operator=(MappedFile&& o) noexcept { if(this != &o){ close(); swap(o); } return *this; }
+
+    bool open(const std::string& path);
+    void close();
+
+    // hint that [offset, offset+bytes) is needed soon; the OS reads it in
+    // the background instead of faulting page by page later
+    void prefetch(size_t offset, size_t bytes) const;
+
+    bool isOpen() const { return opened; }
+    const uint8_t* data() const { return ptr; }
+    size_t size() const { return len; }
+
+private:
+    const uint8_t* ptr = nullptr;
+    size_t len = 0;
+    bool opened = false;
+#if defined(_WIN32)
+    void* file = nullptr;           // HANDLEs
+    void* mapping = nullptr;
+#endif
+
+    void swap(MappedFile& o){
+        std::swap(ptr, o.ptr); std::swap(len, o.len); std::swap(opened, o.opened);
+#if defined(_WIN32)
+        std::swap(file, o.file); std::swap(mapping, o.mapping);
+#endif
+    }
+};
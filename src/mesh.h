@@ -1,6 +1,11 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
@@ -10,31 +15,261 @@ struct Vertex {
     glm::vec2 uv;
 };
 
+// 16-byte compressed vertex: unorm16 position inside the mesh bounds,
+// octahedral snorm16 normal, half-float uv
+struct QVertex {
+    uint16_t pos[3];
+    uint16_t pad;
+    int16_t  nrm[2];
+    uint16_t uv[2];
+};
+static_assert(sizeof(QVertex) == 16, "QVertex must stay half of Vertex");
+
+enum class VertexFormat : uint32_t { Float = 0, Quantized = 1 };
+
+// position = offset + unorm * scale; fed to the shader as constant attribs 8/9
+struct Dequant {
+    glm::vec3 offset{0.0f};
+    glm::vec3 scale{1.0f};
+};
+
+inline uint16_t floatToHalf(float f){
+    uint32_t x; std::memcpy(&x, &f, 4);
+    uint32_t sign = (x >> 16) & 0x8000u;
+    int32_t  e = (int32_t)((x >> 23) & 0xFF) - 127 + 15;
+    uint32_t m = x & 0x7FFFFFu;
+    if(((x >> 23) & 0xFF) == 0xFF) return (uint16_t)(sign | 0x7C00u | (m ? 0x200u : 0));   // inf / nan
+    if(e >= 31) return (uint16_t)(sign | 0x7C00u);                                          // overflow
+    if(e <= 0){                                                                             // subnormal / zero
+        if(e < -10) return (uint16_t)sign;
+        m |= 0x800000u;
+        uint32_t shift = (uint32_t)(14 - e);
+        uint32_t h = m >> shift;
+        if((m >> (shift - 1)) & 1) ++h;                                                     // round half up
+        return (uint16_t)(sign | h);
+    }
+    uint32_t h = sign | ((uint32_t)e << 10) | (m >> 13);
+    if(m & 0x1000u) ++h;                                                                    // round, may carry into e
+    return (uint16_t)h;
+}
+
+// unit vector -> [-1,1]^2 (octahedron folded onto the z>=0 square)
+inline glm::vec2 octEncode(glm::vec3 n){
+    n /= (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+    glm::vec2 e(n.x, n.y);
+    if(n.z < 0.0f){
+        e = glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                      (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+    }
+    return e;
+}
+
+inline int16_t toSnorm16(float v){ return (int16_t)std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f); }
+inline uint16_t toUnorm16(float v){ return (uint16_t)std::lround(std::clamp(v, 0.0f, 1.0f) * 65535.0f); }
+
+// per-instance attributes: model matrix at locations 3..6, colour at 7
+struct InstanceData {
+    glm::mat4 model;
+    glm::vec3 color;
+};
+
+struct InstanceBuffer {
+    std::vector<InstanceData> data;   // CPU side, filled by the caller
+    GLuint vbo=0;
+    size_t capacity=0;                // instances the GL buffer can hold
+
+    // push data to the GPU; STREAM re-specifies (orphans) the storage each call
+    void upload(GLenum usage = GL_STATIC_DRAW){
+        if(!vbo) glGenBuffers(1, &vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        if(data.size() > capacity || usage == GL_STREAM_DRAW){
+            capacity = std::max(capacity, data.size());
+            glBufferData(GL_ARRAY_BUFFER, capacity*sizeof(InstanceData), nullptr, usage);
+        }
+        if(!data.empty()) glBufferSubData(GL_ARRAY_BUFFER, 0, data.size()*sizeof(InstanceData), data.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    GLsizei count() const { return (GLsizei)data.size(); }
+};
+
+// attribute layout 0..2 for the VAO/VBO currently bound
+inline void setVertexAttribs(VertexFormat fmt){
+    if(fmt == VertexFormat::Quantized){
+        glEnableVertexAttribArray(0); glVertexAttribPointer(0,3,GL_UNSIGNED_SHORT,GL_TRUE,sizeof(QVertex),(void*)offsetof(QVertex,pos));
+        glEnableVertexAttribArray(1); glVertexAttribPointer(1,2,GL_SHORT,GL_TRUE,sizeof(QVertex),(void*)offsetof(QVertex,nrm));
+        glEnableVertexAttribArray(2); glVertexAttribPointer(2,2,GL_HALF_FLOAT,GL_FALSE,sizeof(QVertex),(void*)offsetof(QVertex,uv));
+    } else {
+        glEnableVertexAttribArray(0); glVertexAttribPointer(0,3,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)0);
+        glEnableVertexAttribArray(1); glVertexAttribPointer(1,3,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,normal));
+        glEnableVertexAttribArray(2); glVertexAttribPointer(2,2,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,uv));
+    }
+}
+
+// constant attribs (not VAO state): 8 = offset.xyz + octahedral flag, 9 = scale
+inline void bindDequant(const Dequant& d, VertexFormat fmt){
+    glVertexAttrib4f(8, d.offset.x, d.offset.y, d.offset.z, fmt == VertexFormat::Quantized ? 1.0f : 0.0f);
+    glVertexAttrib3f(9, d.scale.x, d.scale.y, d.scale.z);
+}
+
+// per-instance arrays 3..7 on the bound VAO, starting at instance `first`
+// (GL 3.3 has no base instance, so the pointers move instead); unbind
+// afterwards so plain draws on the same VAO never read instance data
+inline void bindInstanceAttribs(const InstanceBuffer& ib, size_t first = 0){
+    const size_t base = first * sizeof(InstanceData);
+    glBindBuffer(GL_ARRAY_BUFFER, ib.vbo);
+    for(int c=0;c<4;++c){
+        glEnableVertexAttribArray(3+c);
+        glVertexAttribPointer(3+c,4,GL_FLOAT,GL_FALSE,sizeof(InstanceData),(void*)(base + offsetof(InstanceData,model) + c*sizeof(glm::vec4)));
+        glVertexAttribDivisor(3+c,1);
+    }
+    glEnableVertexAttribArray(7);
+    glVertexAttribPointer(7,3,GL_FLOAT,GL_FALSE,sizeof(InstanceData),(void*)(base + offsetof(InstanceData,color)));
+    glVertexAttribDivisor(7,1);
+}
+inline void unbindInstanceAttribs(){
+    for(int a=3;a<=7;++a) glDisableVertexAttribArray(a);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 struct Mesh {
+    // index range into the shared index buffer; error = model-space size of
+    // the simplification grid cell (0 for full detail)
+    struct Lod { uint32_t first=0, count=0; float error=0.0f; };
+    static constexpr int kMaxLods = 4;
+
     std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
-    GLuint vao=0, vbo=0, ebo=0;
+    std::vector<unsigned int> indices;  // every LOD back to back
+    std::vector<Lod> lods;              // lods[0] = full detail; empty = whole buffer
+    std::vector<QVertex> qvertices;   // Quantized format (vertices emptied by quantize)
+    std::vector<uint16_t> indices16;  // Quantized format with < 65536 vertices
+    VertexFormat format = VertexFormat::Float;
+    Dequant dequant;
+    GLuint vao=0, vbo=0, ebo=0;         // own buffers (upload); 0 when packed into a Model
+    GLint baseVertex=0;                 // packed: first vertex / index in the Model's buffers
+    uint32_t firstIndex=0;
+    GLsizei indexCount=0;             // set by upload; vectors may be empty for cached meshes
+    GLenum indexType=GL_UNSIGNED_INT;
+    size_t vertexCount=0;
+    size_t gpuBytes=0;                // vertex + index buffer storage
     GLuint diffuseTex=0;
     bool hasTexture=false;
 
+    static size_t vertexSize(VertexFormat f){ return f == VertexFormat::Quantized ? sizeof(QVertex) : sizeof(Vertex); }
+    // what the same mesh costs as float vertices + 32-bit indices
+    size_t floatBytes() const { return vertexCount*sizeof(Vertex) + (size_t)indexCount*sizeof(unsigned int); }
+    size_t cpuBytes() const {
+        return vertices.capacity()*sizeof(Vertex) + indices.capacity()*sizeof(unsigned int)
+             + qvertices.capacity()*sizeof(QVertex) + indices16.capacity()*sizeof(uint16_t);
+    }
+
+    bool bounds(glm::vec3& lo, glm::vec3& hi) const {
+        if(vertices.empty()) return false;
+        lo = hi = vertices[0].pos;
+        for(auto& v : vertices){ lo = glm::min(lo, v.pos); hi = glm::max(hi, v.pos); }
+        return true;
+    }
+    static Dequant dequantFor(glm::vec3 lo, glm::vec3 hi){
+        return Dequant{ lo, glm::max(hi - lo, glm::vec3(1e-8f)) };
+    }
+
+    // CPU only (worker safe): float vertices -> QVertex, 16-bit indices when
+    // they fit (and allow16); the float arrays are released. `shared` quantizes
+    // against common bounds so several meshes can draw with one Dequant.
+    void quantize(const Dequant* shared = nullptr, bool allow16 = true){
+        if(format == VertexFormat::Quantized) return;
+        if(shared) dequant = *shared;
+        else {
+            glm::vec3 lo(0.0f), hi(0.0f);
+            bounds(lo, hi);
+            dequant = dequantFor(lo, hi);
+        }
+        qvertices.resize(vertices.size());
+        for(size_t i=0; i<vertices.size(); ++i){
+            const Vertex& v = vertices[i];
+            QVertex& q = qvertices[i];
+            glm::vec3 t = (v.pos - dequant.offset) / dequant.scale;
+            for(int c=0; c<3; ++c) q.pos[c] = toUnorm16(t[c]);
+            q.pad = 0;
+            float len = glm::length(v.normal);
+            glm::vec2 e = octEncode(len > 0.0f ? v.normal / len : glm::vec3(0, 1, 0));
+            q.nrm[0] = toSnorm16(e.x); q.nrm[1] = toSnorm16(e.y);
+            q.uv[0] = floatToHalf(v.uv.x); q.uv[1] = floatToHalf(v.uv.y);
+        }
+        if(allow16 && vertices.size() <= 65536){
+            indices16.assign(indices.begin(), indices.end());
+            std::vector<unsigned int>().swap(indices);
+        }
+        std::vector<Vertex>().swap(vertices);
+        format = VertexFormat::Quantized;
+    }
+
     void upload(){
+        if(format == VertexFormat::Quantized){
+            if(!indices16.empty()) upload(qvertices.data(), qvertices.size(), format, indices16.data(), indices16.size(), GL_UNSIGNED_SHORT);
+            else                   upload(qvertices.data(), qvertices.size(), format, indices.data(), indices.size(), GL_UNSIGNED_INT);
+        } else {
+            upload(vertices.data(), vertices.size(), indices.data(), indices.size());
+        }
+    }
+    void upload(const Vertex* v, size_t vCount, const unsigned int* idx, size_t idxCount){
+        upload(v, vCount, VertexFormat::Float, idx, idxCount, GL_UNSIGNED_INT);
+    }
+    // straight from caller memory (e.g. a mapped mesh cache), no CPU-side copy kept
+    void upload(const void* v, size_t vCount, VertexFormat fmt, const void* idx, size_t idxCount, GLenum idxType){
         if(vao) return;
+        format = fmt;
+        vertexCount = vCount;
+        indexCount = (GLsizei)idxCount;
+        indexType = idxType;
+        const size_t idxSize = idxType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+        gpuBytes = vCount*vertexSize(fmt) + idxCount*idxSize;
         glGenVertexArrays(1, &vao);
         glGenBuffers(1, &vbo);
         glGenBuffers(1, &ebo);
         glBindVertexArray(vao);
         glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size()*sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, vCount*vertexSize(fmt), v, GL_STATIC_DRAW);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size()*sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0); glVertexAttribPointer(0,3,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)0);
-        glEnableVertexAttribArray(1); glVertexAttribPointer(1,3,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,normal));
-        glEnableVertexAttribArray(2); glVertexAttribPointer(2,2,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,uv));
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, idxCount*idxSize, idx, GL_STATIC_DRAW);
+        setVertexAttribs(fmt);
+        glBindVertexArray(0);
+    }
+    // CPU-side arrays as upload() would send them (mesh cache, packed models)
+    const void* vertexData() const { return format == VertexFormat::Quantized ? (const void*)qvertices.data() : (const void*)vertices.data(); }
+    size_t vertexDataCount() const { return format == VertexFormat::Quantized ? qvertices.size() : vertices.size(); }
+    bool uses16BitIndices() const { return format == VertexFormat::Quantized && !indices16.empty(); }
+    const void* indexData() const { return uses16BitIndices() ? (const void*)indices16.data() : (const void*)indices.data(); }
+    size_t indexDataCount() const { return uses16BitIndices() ? indices16.size() : indices.size(); }
+
+    void bindDequant() const{ ::bindDequant(dequant, format); }
+    // coarsest LOD whose error stays under maxErrorPx on screen
+    int lodFor(float pixelsPerUnit, float maxErrorPx = 1.0f) const{
+        int best = 0;
+        for(int i=1; i<(int)lods.size(); ++i) if(lods[i].error * pixelsPerUnit <= maxErrorPx) best = i;
+        return best;
+    }
+    GLsizei lodCount(int lod) const{ return lods.empty() ? indexCount : (GLsizei)lods[lod].count; }
+    uint32_t lodFirst(int lod) const{ return firstIndex + (lods.empty() ? 0 : lods[lod].first); }
+    const void* lodOffset(int lod) const{
+        return (const void*)((size_t)lodFirst(lod) * (indexType == GL_UNSIGNED_SHORT ? 2 : 4));
+    }
+
+    void draw(int lod = 0) const{
+        glBindVertexArray(vao);
+        bindDequant();
+        glDrawElements(GL_TRIANGLES, lodCount(lod), indexType, lodOffset(lod));
         glBindVertexArray(0);
     }
-    void draw() const{
+    // one call for instances [first, first+count) of ib, count < 0 = to the
+    // end (shader must have uInstanced = true)
+    void drawInstanced(const InstanceBuffer& ib, int lod = 0, GLsizei first = 0, GLsizei count = -1) const{
+        if(count < 0) count = ib.count() - first;
+        if(count <= 0) return;
         glBindVertexArray(vao);
-        glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0);
+        bindInstanceAttribs(ib, (size_t)first);
+        bindDequant();
+        glDrawElementsInstanced(GL_TRIANGLES, lodCount(lod), indexType, lodOffset(lod), count);
+        unbindInstanceAttribs();
         glBindVertexArray(0);
     }
 };
\ No newline at end of file
@@ -0,0 +1,153 @@
+#pragma once
+#include "mesh.h"
+#include "mapped_file.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+// Compiled mesh cache: "<source>.meshcache" next to the model file holds the
+// post-processed Vertex/index arrays of every mesh, laid out so the mapped
+// file can be handed to glBufferData as-is. Native endian, rebuilt whenever
+// the source path, size, mtime, import flags or vertex format/layout change.
+//
+//   Header | MeshEntry[meshCount] | (vertices, indices) per mesh, 16-byte aligned
+//
+// MeshEntry also holds the LOD index ranges into its mesh's indices.
+namespace mesh_cache {
+
+constexpr uint32_t kMagic   = 0x31434D53;   // "SMC1"
+constexpr uint32_t kVersion = 4;
+
+struct Key {
+    uint64_t pathHash = 0;
+    uint64_t srcSize = 0;
+    int64_t  srcMtime = 0;
+    uint32_t importFlags = 0;
+    VertexFormat format = VertexFormat::Float;
+};
+
+struct Header {
+    uint32_t magic, version, vertexSize, importFlags;
+    uint64_t pathHash, srcSize;
+    int64_t  srcMtime;
+    uint32_t meshCount, vertexFormat;
+};
+
+struct MeshEntry {
+    uint64_t vertexOffset, vertexCount;   // offsets from the start of the file
+    uint64_t indexOffset, indexCount;
+    uint32_t indexSize, lodCount;         // 2 or 4 bytes; Mesh::lods entries used
+    float dequantOffset[3], dequantScale[3];
+    uint32_t lodFirst[Mesh::kMaxLods], lodIndexCount[Mesh::kMaxLods];
+    float lodError[Mesh::kMaxLods];
+};
+
+// bumped from loader threads
+struct Stats {
+    std::atomic<int> hits{0}, misses{0}, writeFailures{0};
+};
+inline Stats& stats(){ static Stats s; return s; }
+
+inline std::string pathFor(const std::string& src){ return src + ".meshcache"; }
+
+inline uint64_t hashPath(const std::string& s){
+    uint64_t h = 1469598103934665603ull;
+    for(unsigned char c : s){ h ^= c; h *= 1099511628211ull; }
+    return h;
+}
+
+// false if the source file does not exist (no import attempt needed)
+inline bool keyFor(const std::string& src, uint32_t flags, VertexFormat fmt, Key& k){
+    std::error_code ec;
+    auto size = std::filesystem::file_size(src, ec);
+    if(ec) return false;
+    auto mtime = std::filesystem::last_write_time(src, ec);
+    if(ec) return false;
+    k.pathHash = hashPath(src);
+    k.srcSize = size;
+    k.srcMtime = (int64_t)mtime.time_since_epoch().count();
+    k.importFlags = flags;
+    k.format = fmt;
+    return true;
+}
+
+// entries of a mapped cache file, nullptr if it is stale or malformed
+inline const MeshEntry* validate(const MappedFile& f, const Key& k, uint32_t& meshCount){
+    if(f.size() < sizeof(Header)) return nullptr;
+    const Header* h = (const Header*)f.data();
+    if(h->magic != kMagic || h->version != kVersion) return nullptr;
+    if(h->vertexFormat != (uint32_t)k.format || h->vertexSize != Mesh::vertexSize(k.format)) return nullptr;
+    if(h->pathHash != k.pathHash || h->srcSize != k.srcSize || h->srcMtime != k.srcMtime
+       || h->importFlags != k.importFlags) return nullptr;
+    if(sizeof(Header) + (uint64_t)h->meshCount * sizeof(MeshEntry) > f.size()) return nullptr;
+    const MeshEntry* e = (const MeshEntry*)(f.data() + sizeof(Header));
+    for(uint32_t i=0; i<h->meshCount; ++i){
+        if(e[i].indexSize != 2 && e[i].indexSize != 4) return nullptr;
+        if(e[i].lodCount > (uint32_t)Mesh::kMaxLods) return nullptr;
+        for(uint32_t l=0; l<e[i].lodCount; ++l)
+            if((uint64_t)e[i].lodFirst[l] + e[i].lodIndexCount[l] > e[i].indexCount) return nullptr;
+        if(e[i].vertexOffset + e[i].vertexCount * h->vertexSize > f.size()) return nullptr;
+        if(e[i].indexOffset + e[i].indexCount * e[i].indexSize > f.size()) return nullptr;
+    }
+    meshCount = h->meshCount;
+    return e;
+}
+
+// write next to the source via a temp file + rename so a crash never leaves a torn cache
+inline bool write(const std::string& src, const Key& k, const std::vector<Mesh>& meshes){
+    auto align = [](uint64_t v){ return (v + 15) & ~uint64_t(15); };
+    const uint32_t vsize = (uint32_t)Mesh::vertexSize(k.format);
+    Header h{ kMagic, kVersion, vsize, k.importFlags,
+              k.pathHash, k.srcSize, k.srcMtime, (uint32_t)meshes.size(), (uint32_t)k.format };
+    std::vector<MeshEntry> entries(meshes.size());
+    uint64_t off = align(sizeof(Header) + entries.size() * sizeof(MeshEntry));
+    for(size_t i=0; i<meshes.size(); ++i){
+        const Mesh& m = meshes[i];
+        if(m.format != k.format) return false;
+        MeshEntry& e = entries[i];
+        e = MeshEntry{};
+        e.vertexCount = m.vertexDataCount();
+        e.indexCount  = m.indexDataCount();
+        e.indexSize   = m.uses16BitIndices() ? 2 : 4;
+        for(int c=0; c<3; ++c){ e.dequantOffset[c] = m.dequant.offset[c]; e.dequantScale[c] = m.dequant.scale[c]; }
+        e.lodCount = (uint32_t)std::min<size_t>(m.lods.size(), Mesh::kMaxLods);
+        for(uint32_t l=0; l<e.lodCount; ++l){
+            e.lodFirst[l] = m.lods[l].first; e.lodIndexCount[l] = m.lods[l].count; e.lodError[l] = m.lods[l].error;
+        }
+        e.vertexOffset = off;
+        off = align(off + e.vertexCount * vsize);
+        e.indexOffset = off;
+        off = align(off + e.indexCount * e.indexSize);
+    }
+
+    const std::string dst = pathFor(src), tmp = dst + ".tmp";
+    {
+        std::ofstream o(tmp, std::ios::binary | std::ios::trunc);
+        if(!o) return false;
+        uint64_t pos = 0;
+        auto put = [&](const void* p, uint64_t n){ o.write((const char*)p, (std::streamsize)n); pos += n; };
+        auto padTo = [&](uint64_t at){ static const char zero[16] = {}; while(pos < at) put(zero, std::min<uint64_t>(16, at - pos)); };
+        put(&h, sizeof(h));
+        put(entries.data(), entries.size() * sizeof(MeshEntry));
+        for(size_t i=0; i<meshes.size(); ++i){
+            padTo(entries[i].vertexOffset);
+            put(meshes[i].vertexData(), entries[i].vertexCount * vsize);
+            padTo(entries[i].indexOffset);
+            put(meshes[i].indexData(), entries[i].indexCount * entries[i].indexSize);
+        }
+        padTo(off);
+        if(!o) return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, dst, ec);
+    if(ec){ std::filesystem::remove(tmp, ec); return false; }
+    return true;
+}
+
+} // namespace mesh_cache
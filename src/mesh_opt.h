@@ -0,0 +1,272 @@
+#pragma once
+#include "mesh.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Import-time index processing (CPU only, runs on loader workers):
+//  - Forsyth's linear-speed vertex cache optimisation
+//  - overdraw: cache-order clusters sorted so outward-facing ones come first
+//  - LODs by vertex clustering; every LOD reuses the mesh's vertex buffer
+namespace mesh_opt {
+
+constexpr int kFifoSize   = 16;   // cache size used for ACMR reporting
+constexpr int kForsythLru = 32;   // cache size the Forsyth scores assume
+
+// average cache misses per triangle on a FIFO post-transform cache
+inline float acmr(const unsigned int* idx, size_t count, size_t vertexCount, int cacheSize = kFifoSize){
+    if(count < 3) return 0.0f;
+    std::vector<uint32_t> stamp(vertexCount, 0);   // FIFO position + 1 when inserted
+    uint32_t time = 0, misses = 0;
+    for(size_t i=0; i<count; ++i){
+        unsigned v = idx[i];
+        if(stamp[v] == 0 || time - stamp[v] >= (uint32_t)cacheSize){ stamp[v] = ++time; ++misses; }
+    }
+    return (float)misses / (float)(count / 3);
+}
+
+// Tom Forsyth, "Linear-Speed Vertex Cache Optimisation" (2006)
+inline void optimizeVertexCache(unsigned int* idx, size_t count, size_t vertexCount){
+    const size_t triCount = count / 3;
+    if(triCount < 2) return;
+
+    auto vertexScore = [](int cachePos, int remaining){
+        if(remaining == 0) return -1.0f;
+        float s = 0.0f;
+        if(cachePos >= 0){
+            if(cachePos < 3) s = 0.75f;
+            else s = std::pow(1.0f - (float)(cachePos - 3) / (kForsythLru - 3), 1.5f);
+        }
+        return s + 2.0f / std::sqrt((float)remaining);
+    };
+
+    // a vertex repeated inside one (degenerate) triangle counts once
+    auto distinct = [&](size_t t, int k){
+        const unsigned* tri = idx + t*3;
+        return (k == 0) || (k == 1 && tri[1] != tri[0]) || (k == 2 && tri[2] != tri[0] && tri[2] != tri[1]);
+    };
+    std::vector<int> valence(vertexCount, 0), offset(vertexCount + 1, 0), cachePos(vertexCount, -1);
+    for(size_t t=0; t<triCount; ++t) for(int k=0; k<3; ++k) if(distinct(t, k)) valence[idx[t*3+k]]++;
+    for(size_t v=0; v<vertexCount; ++v) offset[v+1] = offset[v] + valence[v];
+    std::vector<int> adj(offset[vertexCount]), fill(offset.begin(), offset.end() - 1);
+    for(size_t t=0; t<triCount; ++t) for(int k=0; k<3; ++k) if(distinct(t, k)) adj[fill[idx[t*3+k]]++] = (int)t;
+    std::vector<int> remaining = valence;
+
+    std::vector<float> vscore(vertexCount), tscore(triCount, 0.0f);
+    for(size_t v=0; v<vertexCount; ++v) vscore[v] = vertexScore(-1, remaining[v]);
+    for(size_t t=0; t<triCount; ++t) tscore[t] = vscore[idx[t*3]] + vscore[idx[t*3+1]] + vscore[idx[t*3+2]];
+    std::vector<uint8_t> emitted(triCount, 0);
+
+    std::vector<unsigned> out;
+    out.reserve(count);
+    std::vector<int> cache, next;
+    cache.reserve(kForsythLru + 3); next.reserve(kForsythLru + 3);
+    size_t scan = 0;
+
+    int best = -1;
+    for(size_t emittedCount=0; emittedCount<triCount; ++emittedCount){
+        if(best < 0){   // cache gave nothing: best remaining triangle, scanning forward
+            float bs = -1e30f;
+            for(size_t t=scan; t<triCount; ++t) if(!emitted[t] && tscore[t] > bs){ bs = tscore[t]; best = (int)t; }
+            while(scan < triCount && emitted[scan]) ++scan;
+        }
+        const unsigned* tri = idx + (size_t)best*3;
+        emitted[best] = 1;
+        out.insert(out.end(), tri, tri + 3);
+
+        // LRU: triangle's vertices to the front
+        next.clear();
+        for(int k=0; k<3; ++k) if(distinct((size_t)best, k)) next.push_back((int)tri[k]);
+        for(int v : cache) if(v != (int)tri[0] && v != (int)tri[1] && v != (int)tri[2]) next.push_back(v);
+        for(int k=0; k<3; ++k){
+            if(!distinct((size_t)best, k)) continue;
+            int v = (int)tri[k];
+            remaining[v]--;
+            for(int a=offset[v]; a<offset[v] + valence[v]; ++a)
+                if(adj[a] == best){ adj[a] = adj[offset[v] + remaining[v]]; adj[offset[v] + remaining[v]] = best; break; }
+        }
+        for(int v : cache) cachePos[v] = -1;
+        for(size_t p=0; p<next.size(); ++p) cachePos[next[p]] = p < (size_t)kForsythLru ? (int)p : -1;
+        // rescore cached vertices (and the ones pushed out) and their triangles
+        best = -1;
+        float bs = -1e30f;
+        for(int v : next){
+            float ns = vertexScore(cachePos[v], remaining[v]);
+            float d = ns - vscore[v];
+            vscore[v] = ns;
+            for(int a=offset[v]; a<offset[v] + remaining[v]; ++a){
+                int t = adj[a];
+                tscore[t] += d;
+            }
+        }
+        for(size_t p=0; p<next.size() && p<(size_t)kForsythLru; ++p){
+            int v = next[p];
+            for(int a=offset[v]; a<offset[v] + remaining[v]; ++a){
+                int t = adj[a];
+                if(tscore[t] > bs){ bs = tscore[t]; best = t; }
+            }
+        }
+        if(next.size() > (size_t)kForsythLru) next.resize(kForsythLru);
+        cache.swap(next);
+    }
+    std::copy(out.begin(), out.end(), idx);
+}
+
+// Keeps the cache order in clusters (split where a triangle misses on all
+// three vertices) and sorts clusters by how far they face away from the mesh
+// centre, so outer surfaces draw first and occlude the rest. Falls back to
+// the input order if ACMR would grow by more than `threshold`.
+inline void optimizeOverdraw(unsigned int* idx, size_t count, const Vertex* verts, size_t vertexCount, float threshold = 1.05f){
+    const size_t triCount = count / 3;
+    if(triCount < 8) return;
+    const float before = acmr(idx, count, vertexCount);
+
+    std::vector<size_t> starts;
+    {
+        std::vector<uint32_t> stamp(vertexCount, 0);
+        uint32_t time = 0;
+        for(size_t t=0; t<triCount; ++t){
+            int miss = 0;
+            for(int k=0; k<3; ++k){
+                unsigned v = idx[t*3+k];
+                if(stamp[v] == 0 || time - stamp[v] >= (uint32_t)kFifoSize){ stamp[v] = ++time; ++miss; }
+            }
+            if(miss == 3 || t == 0) starts.push_back(t);
+        }
+    }
+    starts.push_back(triCount);
+    if(starts.size() <= 2) return;
+
+    glm::vec3 centre(0.0f);
+    for(size_t v=0; v<vertexCount; ++v) centre += verts[v].pos;
+    centre = centre / (float)std::max<size_t>(1, vertexCount);
+
+    struct Cluster { size_t first, last; float key; };
+    std::vector<Cluster> clusters;
+    for(size_t c=0; c+1<starts.size(); ++c){
+        glm::vec3 mid(0.0f), nrm(0.0f);
+        float area = 0.0f;
+        for(size_t t=starts[c]; t<starts[c+1]; ++t){
+            glm::vec3 a = verts[idx[t*3]].pos, b = verts[idx[t*3+1]].pos, d = verts[idx[t*3+2]].pos;
+            glm::vec3 n = glm::cross(b - a, d - a);   // length = 2 * area
+            float w = glm::length(n);
+            mid += (a + b + d) * (w / 3.0f);
+            nrm += n;
+            area += w;
+        }
+        float key = 0.0f;
+        if(area > 0.0f){
+            mid = mid / area;
+            float nl = glm::length(nrm);
+            if(nl > 0.0f) key = glm::dot(mid - centre, nrm / nl);
+        }
+        clusters.push_back({ starts[c], starts[c+1], key });
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b){ return a.key > b.key; });
+
+    std::vector<unsigned> out;
+    out.reserve(count);
+    for(auto& c : clusters) out.insert(out.end(), idx + c.first*3, idx + c.last*3);
+    if(acmr(out.data(), out.size(), vertexCount) <= before * threshold) std::copy(out.begin(), out.end(), idx);
+}
+
+// Vertex clustering on a uniform grid of `cell` size: every vertex snaps to
+// the member closest to its cell's mean, degenerate and duplicate triangles
+// are dropped. Indices keep pointing into the original vertex array.
+inline std::vector<unsigned> clusterSimplify(const Vertex* verts, size_t vertexCount,
+                                             const unsigned* idx, size_t count, glm::vec3 lo, float cell){
+    auto key = [&](glm::vec3 p){
+        glm::vec3 g = (p - lo) * (1.0f / cell);
+        uint64_t x = (uint64_t)std::max(0.0f, g.x), y = (uint64_t)std::max(0.0f, g.y), z = (uint64_t)std::max(0.0f, g.z);
+        return (x & 0x1FFFFF) | ((y & 0x1FFFFF) << 21) | ((z & 0x1FFFFF) << 42);
+    };
+    struct Acc { glm::vec3 sum{0.0f}; int n = 0; int rep = -1; float d = 1e30f; };
+    std::unordered_map<uint64_t, Acc> cells;
+    std::vector<uint64_t> keyOf(vertexCount);
+    for(size_t v=0; v<vertexCount; ++v){
+        keyOf[v] = key(verts[v].pos);
+        Acc& a = cells[keyOf[v]];
+        a.sum += verts[v].pos; a.n++;
+    }
+    for(size_t v=0; v<vertexCount; ++v){
+        Acc& a = cells[keyOf[v]];
+        glm::vec3 m = a.sum / (float)a.n;
+        glm::vec3 e = verts[v].pos - m;
+        float d = glm::dot(e, e);
+        if(d < a.d){ a.d = d; a.rep = (int)v; }
+    }
+    std::vector<unsigned> out;
+    std::unordered_set<uint64_t> seen;
+    for(size_t t=0; t+2<count; t+=3){
+        unsigned a = (unsigned)cells[keyOf[idx[t]]].rep, b = (unsigned)cells[keyOf[idx[t+1]]].rep, c = (unsigned)cells[keyOf[idx[t+2]]].rep;
+        if(a == b || b == c || a == c) continue;
+        // rotate so the smallest index leads (keeps winding) for duplicate detection
+        unsigned r[3] = { a, b, c };
+        int m = (r[0] < r[1]) ? (r[0] < r[2] ? 0 : 2) : (r[1] < r[2] ? 1 : 2);
+        uint64_t h = ((uint64_t)r[m] << 42) ^ ((uint64_t)r[(m+1)%3] << 21) ^ (uint64_t)r[(m+2)%3];
+        if(!seen.insert(h).second) continue;
+        out.push_back(a); out.push_back(b); out.push_back(c);
+    }
+    return out;
+}
+
+struct Report {
+    size_t trisBefore = 0, trisAfter = 0;
+    float acmrBefore = 0.0f, acmrAfter = 0.0f;
+    std::vector<size_t> lodTris;   // per LOD, LOD0 included
+};
+
+// reorder LOD0, then append up to kMaxLods-1 simplified LODs to m.indices
+// (float vertices only: run before Mesh::quantize)
+inline Report optimize(Mesh& m){
+    Report r;
+    const size_t vc = m.vertices.size();
+    std::vector<unsigned>& idx = m.indices;
+    r.trisBefore = idx.size() / 3;
+    r.acmrBefore = acmr(idx.data(), idx.size(), vc);
+    m.lods.clear();
+    if(vc == 0 || idx.size() < 3){ r.trisAfter = r.trisBefore; r.acmrAfter = r.acmrBefore; return r; }
+
+    optimizeVertexCache(idx.data(), idx.size(), vc);
+    optimizeOverdraw(idx.data(), idx.size(), m.vertices.data(), vc);
+    r.trisAfter = idx.size() / 3;
+    r.acmrAfter = acmr(idx.data(), idx.size(), vc);
+    m.lods.push_back({ 0, (uint32_t)idx.size(), 0.0f });
+    r.lodTris.push_back(r.trisAfter);
+
+    glm::vec3 lo = m.vertices[0].pos, hi = lo;
+    for(auto& v : m.vertices){ lo = glm::min(lo, v.pos); hi = glm::max(hi, v.pos); }
+    const float extent = std::max(std::max(hi.x - lo.x, hi.y - lo.y), std::max(hi.z - lo.z, 1e-6f));
+
+    const std::vector<unsigned> base(idx.begin(), idx.end());
+    size_t prevTris = r.trisAfter;
+    for(float ratio : { 0.5f, 0.25f, 0.125f }){
+        if((int)m.lods.size() >= Mesh::kMaxLods) break;
+        const size_t target = (size_t)(r.trisAfter * ratio);
+        if(target < 4) break;
+        // finest grid whose result fits the target (coarser grid = fewer triangles)
+        int loN = 1, hiN = 1024;
+        std::vector<unsigned> bestLod;
+        float bestCell = extent;
+        while(loN <= hiN){
+            int n = (loN + hiN) / 2;
+            float cell = extent / (float)n;
+            auto lod = clusterSimplify(m.vertices.data(), vc, base.data(), base.size(), lo, cell);
+            if(lod.size() / 3 <= target){ bestLod.swap(lod); bestCell = cell; loN = n + 1; }
+            else hiN = n - 1;
+        }
+        const size_t tris = bestLod.size() / 3;
+        if(tris == 0 || tris * 10 > prevTris * 9) break;   // < 10% saved, not worth a level
+        optimizeVertexCache(bestLod.data(), bestLod.size(), vc);
+        m.lods.push_back({ (uint32_t)idx.size(), (uint32_t)bestLod.size(), bestCell });
+        idx.insert(idx.end(), bestLod.begin(), bestLod.end());
+        r.lodTris.push_back(tris);
+        prevTris = tris;
+    }
+    return r;
+}
+
+} // namespace mesh_opt
@@ -1,43 +1,263 @@
 #pragma once
 #include "mesh.h"
+#include "mesh_cache.h"
+#include "mesh_opt.h"
+#include "profiler.h"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <chrono>
 #include <filesystem>
 #include <iostream>
 
+// All submeshes live in one VAO / vertex buffer / index buffer (packed at
+// upload), addressed by Mesh::baseVertex and Mesh::firstIndex, so a model is
+// one VAO bind plus one glMultiDrawElementsBaseVertex.
 struct Model {
     std::vector<Mesh> meshes;
     bool loaded=false;
     std::filesystem::path baseDir;
+    GLuint vao=0, vbo=0, ebo=0;
+    GLenum indexType=GL_UNSIGNED_INT;   // one type for every part
+    Dequant dequant;                    // shared by every part (quantized against model bounds)
 
+    static constexpr unsigned kImportFlags =
+        aiProcess_Triangulate |
+        aiProcess_GenSmoothNormals |
+        aiProcess_JoinIdenticalVertices |
+        aiProcess_ImproveCacheLocality |
+        aiProcess_PreTransformVertices |
+        aiProcess_CalcTangentSpace;
+
+    VertexFormat format = VertexFormat::Float;   // set before loading
+    double cpuMs=0.0, uploadMs=0.0;   // import or cache read / GL upload
+    bool fromCache=false;
+
+    size_t gpuBytes() const { size_t n=0; for(auto& m : meshes) n += m.gpuBytes; return n; }
+    size_t floatBytes() const { size_t n=0; for(auto& m : meshes) n += m.floatBytes(); return n; }
+    size_t cpuBytes() const { size_t n=0; for(auto& m : meshes) n += m.cpuBytes(); return n; }
+
+    // synchronous: CPU stage then every GL upload
     bool load(const std::string& path){
-        std::cerr << "Loading model: " << path << std::endl;
-        Assimp::Importer imp;
-        const aiScene* scene = imp.ReadFile(path,
-            aiProcess_Triangulate |
-            aiProcess_GenSmoothNormals |
-            aiProcess_JoinIdenticalVertices |
-            aiProcess_ImproveCacheLocality |
-            aiProcess_PreTransformVertices |
-            aiProcess_CalcTangentSpace
-        );
-        if(!scene || !scene->mRootNode){
-            std::cerr << "Assimp error: " << imp.GetErrorString() << "\n";
-            loaded=false; return false;
-        }
+        PROF_ZONE("Model::load");
+        if(!loadCPU(path)) return false;
+        while(!uploadNext()) {}
+        return true;
+    }
+
+    // CPU stage, no GL calls (safe on a worker thread): mesh cache first,
+    // Assimp only when it is missing or stale
+    bool loadCPU(const std::string& path){
+        PROF_ZONE("Model::loadCPU");
+        auto t0 = std::chrono::steady_clock::now();
+        auto& st = mesh_cache::stats();
+        loaded=false; uploaded=0; uploadMs=0.0;
+        dequant = Dequant{}; indexType = GL_UNSIGNED_INT;
+        meshes.clear(); cached=nullptr; mapped.close();
+        mesh_cache::Key key;
+        if(!mesh_cache::keyFor(path, kImportFlags, format, key)) return false;   // no file, skip the import
         baseDir = std::filesystem::path(path).parent_path();
-        processNode(scene->mRootNode, scene);
-        for(auto& m : meshes) m.upload();
+
+        fromCache = openCached(path, key);
+        if(!fromCache){
+            PROF_ZONE("Model::import");
+            Assimp::Importer imp;
+            const aiScene* scene = imp.ReadFile(path, kImportFlags);
+            if(!scene || !scene->mRootNode){
+                std::cerr << "Assimp error: " << imp.GetErrorString() << "\n";
+                return false;
+            }
+            processNode(scene->mRootNode, scene);
+            optimizeMeshes(path);
+            if(format == VertexFormat::Quantized) quantizeShared();
+            if(!mesh_cache::write(path, key, meshes)){
+                st.writeFailures++;
+                std::cerr << "Mesh cache: could not write " << mesh_cache::pathFor(path) << "\n";
+            }
+        }
+        (fromCache ? st.hits : st.misses)++;
+        cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        std::cerr << "Loading model: " << path << (fromCache ? " (cache) " : " (import) ") << cpuMs << " ms" << std::endl;
+        return true;
+    }
+
+    // GL stage, main thread: one mesh per call; true once every mesh is on the GPU
+    bool uploadNext(){
+        PROF_ZONE("Model::uploadNext");
+        auto t0 = std::chrono::steady_clock::now();
+        if(!vao && !meshes.empty()) beginPacked();
+        if(uploaded < meshes.size()){
+            uploadPart(uploaded);
+            ++uploaded;
+        }
+        uploadMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        if(uploaded < meshes.size()) return false;
+        cached=nullptr; mapped.close();
         loaded=true;
+        std::cerr << "Model GPU memory: " << gpuBytes() << " bytes (float layout " << floatBytes()
+                  << "), CPU " << cpuBytes() << " bytes" << std::endl;
         return true;
     }
 
-    void draw() const {
-        for(auto& m : meshes) m.draw();
+    // pixelsPerUnit: screen pixels per model-space unit (Camera::pixelsPerUnit
+    // times the model scale); the default keeps full detail
+    void draw(float pixelsPerUnit = 1e30f) const {
+        if(!vao) return;
+        gatherParts(pixelsPerUnit);
+        glBindVertexArray(vao);
+        bindDequant(dequant, format);
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, drawCounts.data(), indexType, drawOffsets.data(),
+                                      (GLsizei)drawCounts.size(), drawBases.data());
+        glBindVertexArray(0);
+    }
+    // GL 3.3 has no instanced multi-draw: one call per part, still one VAO bind
+    void drawInstanced(const InstanceBuffer& ib, float pixelsPerUnit = 1e30f, GLsizei first = 0, GLsizei count = -1) const {
+        if(count < 0) count = ib.count() - first;
+        if(!vao || count <= 0) return;
+        gatherParts(pixelsPerUnit);
+        glBindVertexArray(vao);
+        bindInstanceAttribs(ib, (size_t)first);
+        bindDequant(dequant, format);
+        for(size_t i=0; i<drawCounts.size(); ++i)
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, drawCounts[i], indexType, drawOffsets[i], count, drawBases[i]);
+        unbindInstanceAttribs();
+        glBindVertexArray(0);
     }
 
 private:
+    MappedFile mapped;                              // cache file held open until uploaded
+    const mesh_cache::MeshEntry* cached=nullptr;
+    size_t uploaded=0;
+    // per-draw scratch for the multi-draw arrays
+    mutable std::vector<GLsizei> drawCounts;
+    mutable std::vector<const void*> drawOffsets;
+    mutable std::vector<GLint> drawBases;
+
+    void gatherParts(float pixelsPerUnit) const {
+        drawCounts.clear(); drawOffsets.clear(); drawBases.clear();
+        for(const auto& m : meshes){
+            int lod = m.lodFor(pixelsPerUnit);
+            if(m.lodCount(lod) == 0) continue;
+            drawCounts.push_back(m.lodCount(lod));
+            drawOffsets.push_back(m.lodOffset(lod));
+            drawBases.push_back(m.baseVertex);
+        }
+    }
+
+    // one dequant for the whole model so its parts can share a draw
+    void quantizeShared(){
+        glm::vec3 lo(0.0f), hi(0.0f);
+        bool any = false, fits16 = true;
+        for(auto& m : meshes){
+            glm::vec3 l, h;
+            if(m.bounds(l, h)){
+                lo = any ? glm::min(lo, l) : l;
+                hi = any ? glm::max(hi, h) : h;
+                any = true;
+            }
+            fits16 = fits16 && m.vertices.size() <= 65536;   // indices are local to the part
+        }
+        dequant = Mesh::dequantFor(lo, hi);
+        for(auto& m : meshes) m.quantize(&dequant, fits16);
+    }
+
+    // part sizes and data, from the mapped cache or the CPU arrays
+    size_t partVertices(size_t i) const { return cached ? (size_t)cached[i].vertexCount : meshes[i].vertexDataCount(); }
+    size_t partIndices(size_t i) const { return cached ? (size_t)cached[i].indexCount : meshes[i].indexDataCount(); }
+    const void* partVertexData(size_t i) const { return cached ? mapped.data() + cached[i].vertexOffset : meshes[i].vertexData(); }
+    const void* partIndexData(size_t i) const { return cached ? mapped.data() + cached[i].indexOffset : meshes[i].indexData(); }
+
+    // allocate the shared buffers and lay the parts out back to back
+    void beginPacked(){
+        if(!cached) indexType = meshes[0].uses16BitIndices() ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        const size_t vsize = Mesh::vertexSize(format), isize = indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+        size_t vtotal = 0, itotal = 0;
+        for(size_t i=0; i<meshes.size(); ++i){
+            Mesh& m = meshes[i];
+            m.format = format;
+            m.dequant = dequant;
+            m.baseVertex = (GLint)vtotal;
+            m.firstIndex = (uint32_t)itotal;
+            m.vertexCount = partVertices(i);
+            m.indexCount = (GLsizei)partIndices(i);
+            m.indexType = indexType;
+            m.gpuBytes = m.vertexCount*vsize + (size_t)m.indexCount*isize;
+            vtotal += m.vertexCount;
+            itotal += (size_t)m.indexCount;
+        }
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glGenBuffers(1, &ebo);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, vtotal*vsize, nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, itotal*isize, nullptr, GL_STATIC_DRAW);
+        setVertexAttribs(format);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void uploadPart(size_t i){
+        const Mesh& m = meshes[i];
+        const size_t vsize = Mesh::vertexSize(format), isize = indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)(m.baseVertex*vsize), m.vertexCount*vsize, partVertexData(i));
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (GLintptr)(m.firstIndex*isize), (size_t)m.indexCount*isize, partIndexData(i));
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    bool openCached(const std::string& path, const mesh_cache::Key& key){
+        if(!mapped.open(mesh_cache::pathFor(path))) return false;
+        uint32_t n = 0;
+        cached = mesh_cache::validate(mapped, key, n);
+        if(!cached){ mapped.close(); return false; }
+        // packed drawing needs one index size and one dequant for all parts
+        for(uint32_t i=1; i<n; ++i){
+            if(cached[i].indexSize != cached[0].indexSize
+               || std::memcmp(cached[i].dequantOffset, cached[0].dequantOffset, sizeof(float)*6) != 0){
+                cached = nullptr; mapped.close(); return false;
+            }
+        }
+        if(n){
+            indexType = cached[0].indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+            dequant.offset = { cached[0].dequantOffset[0], cached[0].dequantOffset[1], cached[0].dequantOffset[2] };
+            dequant.scale  = { cached[0].dequantScale[0],  cached[0].dequantScale[1],  cached[0].dequantScale[2] };
+        }
+        meshes.resize(n);
+        for(uint32_t i=0; i<n; ++i){
+            Mesh& m = meshes[i];
+            m.dequant.offset = { cached[i].dequantOffset[0], cached[i].dequantOffset[1], cached[i].dequantOffset[2] };
+            m.dequant.scale  = { cached[i].dequantScale[0],  cached[i].dequantScale[1],  cached[i].dequantScale[2] };
+            m.lods.resize(cached[i].lodCount);
+            for(uint32_t l=0; l<cached[i].lodCount; ++l)
+                m.lods[l] = { cached[i].lodFirst[l], cached[i].lodIndexCount[l], cached[i].lodError[l] };
+        }
+        return true;
+    }
+
+    // cache reorder + overdraw + LOD chain per mesh, with a before/after report
+    void optimizeMeshes(const std::string& path){
+        size_t trisBefore=0, trisAfter=0, missesBefore=0, missesAfter=0;
+        std::vector<size_t> lodTris;
+        for(auto& m : meshes){
+            mesh_opt::Report r = mesh_opt::optimize(m);
+            trisBefore += r.trisBefore; trisAfter += r.trisAfter;
+            missesBefore += (size_t)std::lround(r.acmrBefore * r.trisBefore);
+            missesAfter  += (size_t)std::lround(r.acmrAfter * r.trisAfter);
+            if(lodTris.size() < r.lodTris.size()) lodTris.resize(r.lodTris.size(), 0);
+            for(size_t l=0; l<r.lodTris.size(); ++l) lodTris[l] += r.lodTris[l];
+        }
+        auto ratio = [](size_t a, size_t b){ return b ? (double)a / (double)b : 0.0; };
+        std::cerr << "Optimized " << path << ": ACMR " << ratio(missesBefore, trisBefore)
+                  << " -> " << ratio(missesAfter, trisAfter) << ", tris " << trisBefore << " -> " << trisAfter
+                  << ", LOD tris";
+        for(size_t t : lodTris) std::cerr << " " << t;
+        std::cerr << std::endl;
+    }
+
     void processNode(aiNode* node, const aiScene* scene){
         for(unsigned i=0;i<node->mNumMeshes;++i){
             aiMesh* a = scene->mMeshes[node->mMeshes[i]];
@@ -47,6 +267,9 @@ private:
             processNode(node->mChildren[i], scene);
         }
     }
+
+public:
+    // one Assimp mesh -> CPU-side Mesh (also driven directly by bench/)
     Mesh processMesh(aiMesh* a, const aiScene* scene){
         Mesh m;
         m.vertices.reserve(a->mNumVertices);
@@ -0,0 +1,204 @@
+#pragma once
+// Frame-phase profiler. Built only with -DSOKOBAN_PROFILE=ON (defines
+// SOKOBAN_PROFILE); otherwise every PROF_* macro expands to nothing and this
+// header pulls in no code.
+//
+//   PROF_ZONE("name")            scoped CPU zone (name must be a string literal)
+//   PROF_THREAD_NAME("name")     label for the calling thread in the trace
+//   PROF_FRAME()                 end of a frame: drains rings, updates stats
+//   PROF_BEGIN_SESSION(t, s)     Chrome trace_event JSON -> t, p50/p95/p99 -> s
+//   PROF_END_SESSION()
+//
+// Each thread writes zones into its own single-producer ring (no locks on
+// the hot path); the frame thread drains every ring in PROF_FRAME().
+
+#if defined(SOKOBAN_PROFILE)
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace prof {
+
+inline uint64_t nowNs(){
+    static const auto epoch = std::chrono::steady_clock::now();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+struct Event {
+    const char* name;       // static string
+    uint64_t beginNs, endNs;
+};
+
+// one writer (the owning thread), one reader (drain); full ring drops events
+struct ThreadRing {
+    static constexpr size_t kCap = 1u << 14;   // power of two
+    Event events[kCap];
+    std::atomic<size_t> head{0}, tail{0};
+    std::atomic<uint64_t> dropped{0};
+    uint32_t tid = 0;
+    std::string name;
+
+    void push(const Event& e){
+        size_t h = head.load(std::memory_order_relaxed);
+        if(h - tail.load(std::memory_order_acquire) >= kCap){ dropped.fetch_add(1, std::memory_order_relaxed); return; }
+        events[h & (kCap-1)] = e;
+        head.store(h + 1, std::memory_order_release);
+    }
+    template<class F> void drain(F&& f){
+        size_t t = tail.load(std::memory_order_relaxed), h = head.load(std::memory_order_acquire);
+        for(; t<h; ++t) f(events[t & (kCap-1)]);
+        tail.store(t, std::memory_order_release);
+    }
+};
+
+// rings outlive their threads (pool workers may exit before the last drain);
+// the lock is only taken when a thread registers or PROF_FRAME walks the list
+struct Registry {
+    std::mutex m;
+    std::vector<std::unique_ptr<ThreadRing>> rings;
+
+    ThreadRing* add(){
+        std::lock_guard<std::mutex> lk(m);
+        rings.push_back(std::make_unique<ThreadRing>());
+        rings.back()->tid = (uint32_t)rings.size();
+        return rings.back().get();
+    }
+};
+inline Registry& registry(){ static Registry r; return r; }
+inline ThreadRing& localRing(){ thread_local ThreadRing* r = registry().add(); return *r; }
+
+// events recorded on another clock domain (GPU timer queries) go here with a
+// fixed pseudo thread id, from the frame thread only
+constexpr uint32_t kGpuTid = 1000;
+
+class Session {
+public:
+    static constexpr size_t kWindow = 1000;        // frames in the rolling summary
+    static constexpr int    kSummaryEvery = 300;   // frames between summary rewrites
+
+    static Session& get(){ static Session s; return s; }
+
+    bool begin(const std::string& tracePath, const std::string& summaryPath){
+        end();
+        trace = std::fopen(tracePath.c_str(), "w");
+        if(!trace) return false;
+        summary = summaryPath;
+        std::fputs("{\"traceEvents\":[\n", trace);
+        first = true;
+        frameTimes.clear(); frames = 0; lastFrameNs = nowNs();
+        writeMeta(kGpuTid, "GPU");
+        return true;
+    }
+    void end(){
+        if(!trace) return;
+        drainAll();
+        writeSummary();
+        std::fputs("\n]}\n", trace);
+        std::fclose(trace);
+        trace = nullptr;
+    }
+
+    void frame(){
+        uint64_t t = nowNs();
+        localRing().push({ "frame", lastFrameNs, t });
+        double ms = (t - lastFrameNs) * 1e-6;
+        lastFrameNs = t;
+        if(!trace){ drainAll(); return; }   // keep rings from filling up
+        if(frameTimes.size() < kWindow) frameTimes.push_back(ms);
+        else frameTimes[frames % kWindow] = ms;
+        ++frames;
+        drainAll();
+        if(frames % kSummaryEvery == 0) writeSummary();
+    }
+
+    // complete event on the GPU track (durations from timer queries)
+    void gpuEvent(const char* name, uint64_t beginNs, uint64_t durNs){
+        if(trace) writeEvent(kGpuTid, { name, beginNs, beginNs + durNs });
+    }
+
+private:
+    std::FILE* trace = nullptr;
+    std::string summary;
+    bool first = true;
+    std::vector<double> frameTimes;
+    uint64_t frames = 0, lastFrameNs = 0;
+
+    Session(){ registry(); }   // constructed first, so destroyed after ~Session
+    ~Session(){ end(); }
+
+    void drainAll(){
+        auto& reg = registry();
+        std::lock_guard<std::mutex> lk(reg.m);
+        for(auto& r : reg.rings){
+            if(!trace){ r->drain([](const Event&){}); continue; }
+            if(!r->name.empty()){ writeMeta(r->tid, r->name.c_str()); r->name.clear(); }
+            r->drain([&](const Event& e){ writeEvent(r->tid, e); });
+        }
+    }
+    void sep(){ if(!first) std::fputs(",\n", trace); first = false; }
+    void writeEvent(uint32_t tid, const Event& e){
+        sep();
+        std::fprintf(trace, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                     e.name, tid, e.beginNs * 1e-3, (e.endNs - e.beginNs) * 1e-3);
+    }
+    void writeMeta(uint32_t tid, const char* name){
+        sep();
+        std::fprintf(trace, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", tid, name);
+    }
+    void writeSummary(){
+        if(frameTimes.empty() || summary.empty()) return;
+        std::vector<double> v = frameTimes;
+        std::sort(v.begin(), v.end());
+        auto pct = [&](double p){ return v[std::min(v.size()-1, (size_t)(p * (v.size()-1) + 0.5))]; };
+        uint64_t dropped = 0;
+        {
+            auto& reg = registry();
+            std::lock_guard<std::mutex> lk(reg.m);
+            for(auto& r : reg.rings) dropped += r->dropped.load(std::memory_order_relaxed);
+        }
+        std::FILE* f = std::fopen(summary.c_str(), "w");
+        if(!f) return;
+        std::fprintf(f, "frames   %llu (last %zu)\n", (unsigned long long)frames, v.size());
+        std::fprintf(f, "p50 ms   %.3f\np95 ms   %.3f\np99 ms   %.3f\nmax ms   %.3f\n", pct(0.50), pct(0.95), pct(0.99), v.back());
+        std::fprintf(f, "dropped  %llu zones\n", (unsigned long long)dropped);
+        std::fclose(f);
+    }
+};
+
+struct Zone {
+    const char* name;
+    uint64_t begin;
+    explicit Zone(const char* n) : name(n), begin(nowNs()) {}
+    ~Zone(){ localRing().push({ name, begin, nowNs() }); }
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+};
+
+inline void threadName(const char* name){
+    auto& r = localRing();
+    std::lock_guard<std::mutex> lk(registry().m);
+    r.name = name;
+}
+
+} // namespace prof
+
+#define PROF_CAT2(a, b) a##b
+#define PROF_CAT(a, b) PROF_CAT2(a, b)
+#define PROF_ZONE(name)              ::prof::Zone PROF_CAT(profZone_, __LINE__)(name)
+#define PROF_THREAD_NAME(name)       ::prof::threadName(name)
+#define PROF_FRAME()                 ::prof::Session::get().frame()
+#define PROF_BEGIN_SESSION(t, s)     ::prof::Session::get().begin(t, s)
+#define PROF_END_SESSION()           ::prof::Session::get().end()
+#else
+#define PROF_ZONE(name)              ((void)0)
+#define PROF_THREAD_NAME(name)       ((void)0)
+#define PROF_FRAME()                 ((void)0)
+#define PROF_BEGIN_SESSION(t, s)     ((void)0)
+#define PROF_END_SESSION()           ((void)0)
+#endif
@@ -0,0 +1,189 @@
+#include "replay.h"
+#include "level_collection.h"
+#include "mapped_file.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+struct Writer {
+    std::vector<uint8_t> buf;
+    void bytes(const void* p, size_t n){ buf.insert(buf.end(), (const uint8_t*)p, (const uint8_t*)p + n); }
+    void u8(uint8_t v){ buf.push_back(v); }
+    void u32(uint32_t v){ for(int i=0; i<4; ++i) buf.push_back((uint8_t)(v >> (8*i))); }
+    void u64(uint64_t v){ for(int i=0; i<8; ++i) buf.push_back((uint8_t)(v >> (8*i))); }
+    void varint(uint32_t v){
+        while(v >= 0x80){ buf.push_back((uint8_t)(v | 0x80)); v >>= 7; }
+        buf.push_back((uint8_t)v);
+    }
+};
+
+// bounds-checked; any read past the end sets ok = false and returns 0
+struct Reader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok = true;
+    bool need(size_t n){ if((size_t)(end - p) < n) ok = false; return ok; }
+    uint8_t u8(){ return need(1) ? *p++ : 0; }
+    uint32_t u32(){ uint32_t v = 0; if(need(4)){ for(int i=0; i<4; ++i) v |= (uint32_t)p[i] << (8*i); p += 4; } return v; }
+    uint64_t u64(){ uint64_t v = 0; if(need(8)){ for(int i=0; i<8; ++i) v |= (uint64_t)p[i] << (8*i); p += 8; } return v; }
+    uint32_t varint(){
+        uint32_t v = 0;
+        for(int shift=0; shift<35; shift+=7){
+            uint8_t b = u8();
+            v |= (uint32_t)(b & 0x7F) << shift;
+            if(!(b & 0x80)) return v;
+        }
+        ok = false;
+        return 0;
+    }
+};
+
+bool fail(std::string* err, const std::string& msg){ if(err) *err = msg; return false; }
+
+} // namespace
+
+uint64_t Replay::hashFile(const std::string& path){
+    MappedFile f(LevelCollection::filePathOf(path));
+    if(!f.isOpen()) return 0;
+    uint64_t h = 0xcbf29ce484222325ull;
+    const uint8_t* d = f.data();
+    for(size_t i=0; i<f.size(); ++i){ h ^= d[i]; h *= 0x100000001b3ull; }
+    return h;
+}
+
+bool Replay::save(const std::string& path) const {
+    Writer w;
+    w.bytes(kMagic, 4);
+    w.u32(kVersion);
+    w.u32(tickRate);
+    w.u32(hashEvery);
+    w.u32(startLevel);
+    w.u64(ticks);
+    w.u32((uint32_t)levels.size());
+    for(const auto& l : levels){
+        w.u32((uint32_t)l.path.size());
+        w.bytes(l.path.data(), l.path.size());
+        w.u64(l.contentHash);
+    }
+    w.u64(initialHash);
+    w.u32((uint32_t)runs.size());
+    for(const auto& r : runs){ w.u8(r.buttons); w.varint(r.ticks); }
+    for(uint32_t h : hashes) w.u32(h);
+
+    std::ofstream f(path, std::ios::binary);
+    if(!f) return false;
+    f.write((const char*)w.buf.data(), (std::streamsize)w.buf.size());
+    return (bool)f;
+}
+
+bool Replay::load(const std::string& path, std::string* err){
+    MappedFile f(path);
+    if(!f.isOpen()) return fail(err, "cannot open " + path);
+    Reader r{ f.data(), f.data() + f.size() };
+    if(!r.need(4) || std::memcmp(r.p, kMagic, 4) != 0) return fail(err, path + ": not a replay");
+    r.p += 4;
+    if(r.u32() != kVersion) return fail(err, path + ": unsupported replay version");
+    tickRate = r.u32();
+    hashEvery = r.u32();
+    startLevel = r.u32();
+    ticks = r.u64();
+    uint32_t nLevels = r.u32();
+    levels.clear();
+    for(uint32_t i=0; i<nLevels && r.ok; ++i){
+        Level l;
+        uint32_t len = r.u32();
+        if(!r.need(len)) break;
+        l.path.assign((const char*)r.p, len);
+        r.p += len;
+        l.contentHash = r.u64();
+        levels.push_back(std::move(l));
+    }
+    initialHash = r.u64();
+    uint32_t nRuns = r.u32();
+    runs.clear();
+    uint64_t total = 0;
+    for(uint32_t i=0; i<nRuns && r.ok; ++i){
+        Run run;
+        run.buttons = r.u8();
+        run.ticks = r.varint();
+        total += run.ticks;
+        runs.push_back(run);
+    }
+    hashes.clear();
+    if(!r.ok) return fail(err, path + ": truncated");
+    // the hash count comes from the header: check it against the runs and
+    // the bytes left before sizing anything by it
+    if(total != ticks || hashEvery == 0 || startLevel >= levels.size()) return fail(err, path + ": inconsistent header");
+    const uint64_t nHashes = ticks / hashEvery;
+    if(nHashes > (uint64_t)(r.end - r.p) / 4) return fail(err, path + ": truncated");
+    hashes.resize((size_t)nHashes);
+    for(auto& h : hashes) h = r.u32();
+    if(!r.ok) return fail(err, path + ": truncated");
+    return true;
+}
+
+void ReplayRecorder::begin(const Simulation& sim, uint32_t hashEvery){
+    replay = Replay{};
+    replay.tickRate = Simulation::kTickRate;
+    replay.hashEvery = hashEvery > 0 ? hashEvery : 1;
+    replay.startLevel = (uint32_t)sim.levelIndex;
+    for(const auto& path : sim.levels) replay.levels.push_back({ path, Replay::hashFile(path) });
+    replay.initialHash = sim.stateHash();
+}
+
+void ReplayRecorder::tick(const SimInput& in, uint64_t stateHash){
+    auto& runs = replay.runs;
+    if(!runs.empty() && runs.back().buttons == in.buttons && runs.back().ticks < UINT32_MAX) runs.back().ticks++;
+    else runs.push_back({ in.buttons, 1 });
+    replay.ticks++;
+    if(replay.ticks % replay.hashEvery == 0) replay.hashes.push_back((uint32_t)stateHash);
+}
+
+ReplayResult runReplay(const Replay& r, Simulation& sim, bool verify){
+    ReplayResult res;
+    if(r.tickRate != (uint32_t)Simulation::kTickRate){
+        res.error = "recorded at " + std::to_string(r.tickRate) + " Hz, simulation runs at " + std::to_string(Simulation::kTickRate) + " Hz";
+        return res;
+    }
+    sim.levels.clear();
+    for(const auto& l : r.levels){
+        if(verify && Replay::hashFile(l.path) != l.contentHash){
+            res.error = "level " + l.path + " differs from the recorded one";
+            return res;
+        }
+        sim.levels.push_back(l.path);
+    }
+    sim.levelIndex = (int)r.startLevel;
+    sim.allCleared = false;
+    sim.loadCurrentLevel();
+    if(verify && sim.stateHash() != r.initialHash){
+        res.diverged = true;
+        return res;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t t = 0;
+    size_t h = 0;
+    for(const auto& run : r.runs){
+        SimInput in;
+        in.buttons = run.buttons;
+        for(uint32_t k=0; k<run.ticks; ++k){
+            sim.step(in);
+            ++t;
+            if(verify && t % r.hashEvery == 0){
+                if((uint32_t)sim.stateHash() != r.hashes[h++]){
+                    res.diverged = true;
+                    res.divergedAt = t - 1;
+                    res.ticks = t;
+                    res.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+                    return res;
+                }
+            }
+        }
+    }
+    res.ticks = t;
+    res.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return res;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "simulation.h"
+
+// Recorded play sessions for reproducing bugs and performance regressions.
+// The simulation already runs on a fixed tick with all input in SimInput,
+// so a session is fully described by the levels, the starting level and one
+// button mask per tick. A state hash (Simulation::stateHash) is stored every
+// `hashEvery` ticks so a replay can tell exactly where it diverges.
+//
+// File layout (.rep, little endian):
+//   "SKRP" u32 version u32 tickRate u32 hashEvery u32 startLevel u64 ticks
+//   u32 levelCount, then per level: u32 pathLen, path bytes, u64 content hash
+//   u64 initial state hash (after loading startLevel)
+//   u32 runCount, then per run: u8 buttons, varint length   (run-length input)
+//   u32 per recorded hash
+struct Replay {
+    static constexpr char     kMagic[4] = { 'S', 'K', 'R', 'P' };
+    static constexpr uint32_t kVersion  = 1;
+
+    struct Level {
+        std::string path;
+        uint64_t contentHash = 0;       // FNV-1a of the file bytes; 0 = unreadable
+    };
+    struct Run {
+        uint8_t buttons = 0;
+        uint32_t ticks = 0;
+    };
+
+    uint32_t tickRate = Simulation::kTickRate;
+    uint32_t hashEvery = 1;
+    uint32_t startLevel = 0;
+    uint64_t ticks = 0;
+    uint64_t initialHash = 0;
+    std::vector<Level> levels;
+    std::vector<Run> runs;
+    std::vector<uint32_t> hashes;       // state after tick k*hashEvery + hashEvery-1
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path, std::string* err = nullptr);
+
+    // collection specs (pack.xsb#12) hash the whole collection file
+    static uint64_t hashFile(const std::string& path);
+};
+
+// Hooked into Simulation::recorder; appends one entry per step().
+struct ReplayRecorder {
+    Replay replay;
+
+    // snapshot levels and starting state; call right after loadCurrentLevel
+    void begin(const Simulation& sim, uint32_t hashEvery = 1);
+    void tick(const SimInput& in, uint64_t stateHash);
+};
+
+struct ReplayResult {
+    uint64_t ticks = 0;
+    double seconds = 0.0;
+    bool diverged = false;
+    uint64_t divergedAt = 0;            // first tick whose hash differs
+    std::string error;                  // level changed on disk, bad tick rate, ...
+    double ticksPerSecond() const { return seconds > 0.0 ? ticks / seconds : 0.0; }
+};
+
+// Runs the replay through Simulation::step as fast as the CPU allows.
+// verify = compare every recorded hash and stop at the first mismatch.
+ReplayResult runReplay(const Replay& r, Simulation& sim, bool verify = true);
@@ -1,8 +1,24 @@
 ﻿#pragma once
 #include <string>
 #include <stdexcept>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
 #include <glad/glad.h>
 
+// FNV-1a; constexpr so call sites can hash uniform names at compile time
+constexpr uint32_t uniformHash(const char* s){
+    uint32_t h = 2166136261u;
+    while(*s){ h ^= (uint8_t)*s++; h *= 16777619u; }
+    return h;
+}
+
+// resolved uniform location; -1 = not active in this program (GL ignores it)
+struct UniformLoc {
+    GLint loc = -1;
+    explicit operator bool() const { return loc >= 0; }
+};
+
 class Shader {
 public:
     GLuint id{};
@@ -27,24 +43,59 @@ public:
 
         glDeleteShader(vs);
         glDeleteShader(fs);
+
+        reflect();
     }
     void use() const { glUseProgram(id); }
-    void setMat4(const char* name, const float* ptr) const {
-        glUniformMatrix4fv(glGetUniformLocation(id, name), 1, GL_FALSE, ptr);
-    }
-    void setVec3(const char* name, float x, float y, float z) const {
-        glUniform3f(glGetUniformLocation(id, name), x,y,z);
-    }
-    void setInt(const char* name, int v) const {
-        glUniform1i(glGetUniformLocation(id, name), v);
-    }
-    void setBool(const char* name, bool v) const {
-        glUniform1i(glGetUniformLocation(id, name), v ? 1 : 0);
+
+    // cached lookup, no GL call; resolve once outside the frame loop
+    UniformLoc uniform(uint32_t hash) const {
+        auto it = locations.find(hash);
+        return it == locations.end() ? UniformLoc{} : UniformLoc{it->second};
     }
-    void setColor(const char* name, float r, float g, float b) const {
-        glUniform3f(glGetUniformLocation(id, name), r,g,b);
+    UniformLoc uniform(const char* name) const { return uniform(uniformHash(name)); }
+
+    // attach a std140 block to a binding point; false if the program lacks it
+    bool bindUniformBlock(const char* name, GLuint binding) const {
+        GLuint idx = glGetUniformBlockIndex(id, name);
+        if(idx == GL_INVALID_INDEX) return false;
+        glUniformBlockBinding(id, idx, binding);
+        return true;
     }
+
+    void setMat4(UniformLoc u, const float* ptr) const { glUniformMatrix4fv(u.loc, 1, GL_FALSE, ptr); }
+    void setVec3(UniformLoc u, float x, float y, float z) const { glUniform3f(u.loc, x,y,z); }
+    void setInt(UniformLoc u, int v) const { glUniform1i(u.loc, v); }
+    void setBool(UniformLoc u, bool v) const { glUniform1i(u.loc, v ? 1 : 0); }
+    void setColor(UniformLoc u, float r, float g, float b) const { glUniform3f(u.loc, r,g,b); }
+
+    // by name: hashed lookup in the cache (no glGetUniformLocation)
+    void setMat4(const char* name, const float* ptr) const { setMat4(uniform(name), ptr); }
+    void setVec3(const char* name, float x, float y, float z) const { setVec3(uniform(name), x,y,z); }
+    void setInt(const char* name, int v) const { setInt(uniform(name), v); }
+    void setBool(const char* name, bool v) const { setBool(uniform(name), v); }
+    void setColor(const char* name, float r, float g, float b) const { setColor(uniform(name), r,g,b); }
 private:
+    std::unordered_map<uint32_t, GLint> locations;   // uniformHash(name) -> location
+
+    // walk the active default-block uniforms once after link
+    void reflect(){
+        GLint count = 0, maxLen = 0;
+        glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLen);
+        std::string name(maxLen > 0 ? maxLen : 1, '\0');
+        for(GLint i=0; i<count; ++i){
+            GLsizei len = 0; GLint size = 0; GLenum type = 0;
+            glGetActiveUniform(id, (GLuint)i, (GLsizei)name.size(), &len, &size, &type, name.data());
+            std::string n(name.data(), len);
+            GLint loc = glGetUniformLocation(id, n.c_str());
+            if(loc < 0) continue;                       // block member
+            if(n.size() > 3 && n.compare(n.size()-3, 3, "[0]") == 0) n.resize(n.size()-3);
+            if(!locations.emplace(uniformHash(n.c_str()), loc).second)
+                std::cerr << "Shader: uniform hash collision on " << n << std::endl;
+        }
+    }
+
     static void check(GLuint obj, bool shader){
         GLint ok=0;
         if(shader){
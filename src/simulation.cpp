@@ -0,0 +1,502 @@
+#include "simulation.h"
+#include "profiler.h"
+#include "replay.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+static inline bool boxOnGoal(const AABB& box, const glm::ivec2& g) {
+    // เผื่อคลาดจุดศูนย์กลางเล็กน้อย
+    const float tol = 0.3f; // กล่องอยู่ใน cell +-0.3
+    return std::abs(box.center.x - g.x) <= tol &&
+        std::abs(box.center.y - g.y) <= tol;
+}
+
+// a crate counts when it sits within tol of the goal tile nearest its
+// centre. Crates cannot overlap, so no two of them count for the same goal,
+// and the total only changes when tryMoveBox moves one.
+bool Simulation::crateOnGoal(const AABB& box) const {
+    glm::ivec2 g((int)std::lround(box.center.x), (int)std::lround(box.center.y));
+    return grid.isGoal(g) && boxOnGoal(box, g);
+}
+
+bool Simulation::winAABB() const {
+    return cratesOnGoals >= grid.goals.size();
+}
+
+static inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// one crate's share of crateHash: slot and exact centre bits, so the XOR
+// total can be patched in O(1) whenever a single crate moves
+static inline uint64_t crateKey(size_t slot, const AABB& box) {
+    uint64_t xy = ((uint64_t)std::bit_cast<uint32_t>(box.center.x) << 32) | std::bit_cast<uint32_t>(box.center.y);
+    return mix64(xy ^ mix64(slot + 1));
+}
+
+uint64_t Simulation::stateHash() const {
+    const AABB& p = playerBox();
+    uint64_t h = crateHash;
+    for (uint64_t v : { (uint64_t)std::bit_cast<uint32_t>(p.center.x), (uint64_t)std::bit_cast<uint32_t>(p.center.y),
+                        (uint64_t)levelIndex, (uint64_t)allCleared, (uint64_t)std::bit_cast<uint32_t>(winTimer),
+                        (uint64_t)(uint32_t)dir.x, (uint64_t)(uint32_t)dir.y })
+        h = mix64(h ^ v);
+    return h;
+}
+
+// the part of a level load that only reads the level file: safe on the
+// pipeline worker (collection is not touched elsewhere while it runs)
+void Simulation::buildLevel(const std::string& spec, PreparedLevel& L) {
+    PROF_ZONE("buildLevel");
+    auto t0 = std::chrono::steady_clock::now();
+    Grid& grid = L.grid;               // not the member: this may run on the worker
+    std::string file, which;
+    if (LevelCollection::splitSpec(spec, file, which)) {
+        // the index stays open while the levels come from the same collection
+        if (collection.path() != file) collection.open(file);
+        long i = collection.find(which);
+        L.loaded = i >= 0 && grid.load(collection, (size_t)i);
+    } else {
+        L.loaded = grid.load(spec);
+    }
+
+    // 1) กำแพงไม่ต้องสร้างลิสต์ AABB แล้ว — คอลิชันอ่านช่อง # จาก grid ตรง ๆ (tileAABB, half = {0.5,0.5})
+
+    // ขนาดคอลลิเดอร์ (half extents) — ปรับเล็กลงให้เดิน/เลาะมุมง่ายขึ้น
+    constexpr float PLAYER_HALF = 0.38f; // เดิม 0.45f
+    constexpr float BOX_HALF = 0.40f; // เดิม 0.45f (ยังเกือบเต็มช่อง กันลอดซอก)
+
+    constexpr glm::vec3 PLAYER_COLOR(0.2f, 0.7f, 0.8f);
+    constexpr glm::vec3 BOX_COLOR(0.8f, 0.6f, 0.3f);
+
+    // 2) ตั้งคอลลิเดอร์ผู้เล่น
+    L.player = L.actors.create({ glm::vec2(grid.player.x, grid.player.y), glm::vec2(PLAYER_HALF) }, PLAYER_COLOR);
+
+    // 3) ตั้งคอลลิเดอร์กล่องตามเลเวล (slot i = grid.boxes[i])
+    L.crates.reserve(grid.boxes.size());
+    for (auto& b : grid.boxes)
+        L.crates.create({ glm::vec2(b.x, b.y), glm::vec2(BOX_HALF) }, BOX_COLOR);
+
+    // 4) depenetration สั้น ๆ กันซ้อนกำแพงตอนเริ่ม (ผู้เล่น/กล่อง)
+    auto depen = [&](AABB& a) {
+        for (int it = 0; it < 4; ++it) {
+            bool any = false;
+            glm::vec2 reach = a.half * 2.0f + glm::vec2(1.0f);
+            forEachWallTile(grid, a.center - a.half - reach, a.center + a.half + reach, [&](const AABB& w) {
+                glm::vec2 aMin = a.center - a.half, aMax = a.center + a.half;
+                glm::vec2 bMin = w.center - w.half, bMax = w.center + w.half;
+                bool overlap = !(aMax.x < bMin.x || aMin.x > bMax.x || aMax.y < bMin.y || aMin.y > bMax.y);
+                if (overlap) {
+                    float ox = std::min(aMax.x - bMin.x, bMax.x - aMin.x);
+                    float oz = std::min(aMax.y - bMin.y, bMax.y - aMin.y);
+                    if (ox < oz) a.center.x += (a.center.x < w.center.x ? -ox : +ox) * 1.001f;
+                    else         a.center.y += (a.center.y < w.center.y ? -oz : +oz) * 1.001f;
+                    any = true;
+                }
+            });
+            if (!any) break;
+        }
+        };
+    depen(L.actors.collider[L.actors.slot(L.player)]);
+    for (auto& box : L.crates.collider) depen(box);
+
+    // crate broadphase at the start cells (resetLevel rebuilds its own)
+    for (size_t i = 0; i < L.crates.size(); ++i) L.boxHash.insert((int)i, L.crates.collider[i]);
+
+    // chunk bounds for frustum culling on the render side
+    L.chunks.build(grid);
+    L.deadlock.build(grid);
+    L.buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// next level onto the pipeline worker; the frontend's render data is built
+// there too, right after the level itself
+void Simulation::prepareLevel(int index) {
+    if (pipeline.preparing() == index) return;
+    pipeline.start(index, [this, spec = levels[index]](PreparedLevel& L) {
+        buildLevel(spec, L);
+        if (prepareRender) L.render = prepareRender(L);
+    });
+}
+
+void Simulation::loadCurrentLevel() {
+    PROF_ZONE("loadCurrentLevel");
+    auto t0 = std::chrono::steady_clock::now();
+    const std::string& spec = levels[levelIndex];
+    // prepared ahead (waits if the worker is not done yet), or built here
+    std::unique_ptr<PreparedLevel> L = pipeline.take(levelIndex);
+    lastLoad = {};
+    lastLoad.prepared = L != nullptr;
+    lastLoad.waitMs = pipeline.waitMs;
+    if (!L) {
+        L = std::make_unique<PreparedLevel>();
+        L->index = levelIndex;
+        buildLevel(spec, *L);
+    }
+    lastLoad.buildMs = L->buildMs;
+    if (!L->loaded) {
+        std::cerr << "Failed to load level: " << spec << "\n";
+    }
+
+    // swap the prepared state in; L takes the previous level
+    std::swap(grid, L->grid);
+    std::swap(actors, L->actors);
+    std::swap(crates, L->crates);
+    player = L->player;
+    std::swap(chunks, L->chunks);
+    DeadlockAnalyzer::Stats dl = deadlock.stats;     // counters run across levels
+    dl.buildMs = L->deadlock.stats.buildMs;
+    std::swap(deadlock, L->deadlock);
+    deadlock.rebind(grid);
+    deadlock.stats = dl;
+    preparedRender = std::move(L->render);
+
+    // จุดเริ่มของด่าน เก็บไว้ให้ resetLevel ไม่ต้องอ่านไฟล์ใหม่
+    initialCrates = crates.collider;
+    initialPlayer = playerBox();
+
+    if (boxHash.stats.queries) {
+        std::cerr << "[broadphase] queries=" << boxHash.stats.queries
+                  << " narrow tests=" << boxHash.stats.narrowTests
+                  << " avoided=" << boxHash.stats.narrowSkipped << "\n";
+    }
+    std::swap(boxHash, L->boxHash);     // already holds the start positions
+    boxHash.stats = {};
+
+    accumulator = 0.0f;
+    restoreStart(false);
+    levelSerial++;
+    pipeline.retire(std::move(L));      // now holds the previous level
+    lastLoad.hitchMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    char line[160];
+    std::snprintf(line, sizeof line, "%s, build %.2f ms, transition %.2f ms (waited %.2f ms)",
+                  lastLoad.prepared ? "prepared ahead" : "loaded on the spot", lastLoad.buildMs, lastLoad.hitchMs, lastLoad.waitMs);
+    std::cerr << "[level] " << levelIndex + 1 << "/" << levels.size() << " " << spec << ": " << line << "\n";
+}
+
+void Simulation::resetLevel() {
+    PROF_ZONE("resetLevel");
+    restoreStart(true);
+}
+
+// rehash = false right after a load: the prepared boxHash is already at the start
+void Simulation::restoreStart(bool rehash) {
+    playerBox() = initialPlayer;
+    std::copy(initialCrates.begin(), initialCrates.end(), crates.collider.begin());
+
+    // broadphase ของกล่อง (สร้างใหม่ทุกครั้งที่เริ่มด่าน)
+    if (rehash) {
+        boxHash.clear();
+        for (size_t i = 0; i < crates.size(); ++i) boxHash.insert((int)i, crates.collider[i]);
+    }
+    cratesOnGoals = 0;
+    crateHash = 0;
+    for (size_t i = 0; i < crates.size(); ++i) {
+        cratesOnGoals += crateOnGoal(crates.collider[i]);
+        crateHash ^= crateKey(i, crates.collider[i]);
+    }
+    history.clear();
+    crateCells.resize(crates.size());
+    for (size_t i = 0; i < crates.size(); ++i)
+        crateCells[i] = glm::ivec2(glm::round(crates.collider[i].center));
+    deadlock.reset(crateCells);
+
+    // 5) รีเซ็ตสถานะการเคลื่อน
+    moveT = 1.0f;
+    dir = { 0,0 };
+    winTimer = 0.0f;
+    snapshotPrevious();
+    syncWorld(1.0f);
+}
+
+void Simulation::setCrateCenter(size_t j, glm::vec2 c) {
+    AABB& A = crates.collider[j];
+    cratesOnGoals -= crateOnGoal(A);
+    crateHash ^= crateKey(j, A);
+    A.center = c;
+    cratesOnGoals += crateOnGoal(A);
+    crateHash ^= crateKey(j, A);
+    boxHash.update((int)j, A);
+    crateMoved(j);
+}
+
+void Simulation::crateMoved(size_t j) {
+    glm::ivec2 cell(glm::round(crates.collider[j].center));
+    if (cell == crateCells[j]) return;
+    deadlock.moveCrate(crateCells[j], cell, glm::ivec2(glm::round(playerBox().center)));
+    crateCells[j] = cell;
+}
+
+bool Simulation::undoPush() {
+    const UndoHistory::Push* p = history.undo();
+    if (!p) return false;
+    playerBox().center = p->playerFrom;        // first: the deadlock check reads it
+    setCrateCenter(p->crate, p->crateFrom);
+    winTimer = 0.0f;
+    return true;
+}
+
+bool Simulation::redoPush() {
+    const UndoHistory::Push* p = history.redo();
+    if (!p) return false;
+    playerBox().center = p->playerTo;        // first: the deadlock check reads it
+    setCrateCenter(p->crate, p->crateTo);
+    winTimer = 0.0f;
+    return true;
+}
+
+void Simulation::restart() {
+    levelIndex = 0;
+    allCleared = false;
+    loadCurrentLevel();
+}
+
+
+// Helper: ลองผลักกล่อง j ด้วย delta; คืน true ถ้าผ่าน (อัปเดตตำแหน่ง), false ถ้าติด
+bool Simulation::tryMoveBox(size_t j, glm::vec2 delta, glm::vec2* movedOut) {
+    AABB& A = crates.collider[j];
+    glm::vec2 old = A.center;
+    const bool wasOnGoal = crateOnGoal(A);
+
+    glm::vec2 n;
+    moveAndCollide(A, delta, grid, &n);
+
+    // ห้ามชนกล่องอื่น -> ถ้าชน revert
+    bool blocked = false;
+    {
+        glm::vec2 aMin = A.center - A.half, aMax = A.center + A.half;
+        boxHash.query(aMin, aMax, [&](int k) {
+            if (k == (int)j) return true;
+            const AABB& B = crates.collider[k];
+            glm::vec2 bMin = B.center - B.half, bMax = B.center + B.half;
+            blocked = !(aMax.x<bMin.x || aMin.x>bMax.x || aMax.y<bMin.y || aMin.y>bMax.y);
+            return !blocked;
+        });
+    }
+    if (blocked) {
+        A.center = old;     // << รีเวิร์ต
+        if (movedOut) *movedOut = glm::vec2(0);
+        return false;
+    }
+    boxHash.update((int)j, A);
+    cratesOnGoals = cratesOnGoals - wasOnGoal + crateOnGoal(A);
+    crateHash ^= crateKey(j, AABB{ old, A.half }) ^ crateKey(j, A);
+    if (A.center != old) history.onPush((uint32_t)j, old, A.center, playerBox().center);
+    crateMoved(j);
+
+    if (movedOut) *movedOut = A.center - old; // ระยะที่ขยับจริง (อาจถูก clip)
+    return true;
+}
+
+// เวอร์ชันง่าย (แนะนำเริ่มจากอันนี้): ขยับแบบ "หนึ่งช่อง" แต่ทดสอบชนแบบ AABB จริง
+void Simulation::tryMoveDiscreteAABB(glm::ivec2 d) {
+    glm::vec2 targetDelta = glm::vec2(d.x, d.y);  // 1 ช่อง
+
+    // ถ้าช่องหน้ามีกล่อง → ทดลองผลักกล่องก่อน
+    // สแกนหา box ที่อยู่หน้า player (AABB overlap หลัง apply delta เล็ก ๆ)
+    int hitBox = -1;
+    AABB probe = playerBox(); probe.center += targetDelta;
+    glm::vec2 aMin = probe.center - probe.half, aMax = probe.center + probe.half;
+    boxHash.query(aMin, aMax, [&](int i) {
+        // ทดสอบ overlap AABB simple
+        const AABB& B = crates.collider[i];
+        glm::vec2 bMin = B.center - B.half, bMax = B.center + B.half;
+        bool overlap = !(aMax.x < bMin.x || aMin.x > bMax.x || aMax.y < bMin.y || aMin.y > bMax.y);
+        if (overlap) { hitBox = i; return false; }
+        return true;
+    });
+
+    if (hitBox >= 0) {
+        // ลองขยับกล่องก่อน
+        glm::vec2 moved;
+        if (tryMoveBox((size_t)hitBox, targetDelta, &moved)) {
+            // กล่องไปได้ → ค่อยขยับผู้เล่น
+            glm::vec2 n;
+            moveAndCollide(playerBox(), moved, grid, &n);
+        }
+        else {
+            // กล่องไปไม่ได้ → ผู้เล่นไม่ไป
+        }
+    }
+    else {
+        // ขยับผู้เล่นชนกำแพงพร้อม slide
+        glm::vec2 n; moveAndCollide(playerBox(), targetDelta, grid, &n);
+    }
+}
+
+
+bool Simulation::cellFree(glm::ivec2 p) const {
+    if(grid.isWall(p)) return false;
+    int idx=-1; if(grid.occupiedByBox(p, &idx)) return false;
+    return true;
+}
+
+void Simulation::tryMove(glm::ivec2 d){
+    glm::ivec2 dest = grid.player + d;
+    if(grid.isWall(dest)) return;
+    int idx=-1;
+    if(grid.occupiedByBox(dest, &idx)){
+        glm::ivec2 beyond = dest + d;
+        if(cellFree(beyond)){
+            grid.moveBox(idx, beyond);
+            // move player into dest
+            grid.player = dest;
+        } else return; // blocked
+    } else {
+        grid.player = dest;
+    }
+    dir = d;
+    moveAnimStart = playerWorld();
+    moveAnimEnd   = glm::vec3(grid.player.x, 0, grid.player.y);
+    moveT = 0.0f;
+}
+
+void Simulation::handleInputAndMove(const SimInput& input, float dt) {
+    PROF_ZONE("handleInputAndMove");
+    // อ่านทิศทางจากหลายปุ่มพร้อมกัน
+    glm::vec2 in(0.0f);
+    if (input.has(SimInput::Right)) in.x += 1.0f;
+    if (input.has(SimInput::Left))  in.x -= 1.0f;
+    if (input.has(SimInput::Down))  in.y += 1.0f; // +Z = ลง
+    if (input.has(SimInput::Up))    in.y -= 1.0f; // -Z = ขึ้น
+
+    if (in.x == 0.0f && in.y == 0.0f) return;
+
+    // นอร์มอลไลซ์ทิศทาง + ตั้งความเร็วหน่วย "ช่องต่อวินาที"
+    float len = glm::length(in);
+    if (len > 0.0f) in /= len;
+
+    const float speed = 5.0f; // เดิน ~5 ช่อง/วินาที
+    glm::vec2 delta = in * speed * dt;
+
+    // --- ถ้า "มีลังอยู่ด้านหน้า" ให้ลองผลักแบบ step ขนาด 1 ช่อง (ยังคงพฤติกรรม Sokoban) ---
+    // เฉพาะกรณีที่ผู้เล่นกดเกือบขนานแกนหลัก (กันการผลักเฉียง)
+    glm::vec2 axis = (std::abs(in.x) > std::abs(in.y)) ? glm::vec2((in.x > 0) ? 1 : -1, 0) : glm::vec2(0, (in.y > 0) ? 1 : -1);
+
+    // โพรบหาลังด้านหน้า (ใช้ AABB overlap ง่าย ๆ)
+    int hitBox = -1;
+    {
+        AABB probe = playerBox();
+        probe.center += axis * 0.6f; // โพรบไปข้างหน้าเล็กน้อย
+        glm::vec2 aMin = probe.center - probe.half, aMax = probe.center + probe.half;
+        boxHash.query(aMin, aMax, [&](int i) {
+            const AABB& B = crates.collider[i];
+            glm::vec2 bMin = B.center - B.half, bMax = B.center + B.half;
+            bool overlap = !(aMax.x < bMin.x || aMin.x > bMax.x || aMax.y < bMin.y || aMin.y > bMax.y);
+            if (overlap) { hitBox = i; return false; }
+            return true;
+        });
+    }
+
+    // axis = ทิศผลักหลัก (1,0) หรือ (0,1) ตามที่คุณคำนวณไว้
+    glm::vec2 movedBox(0);
+
+    // เคสเจอกล่องข้างหน้า
+    if (hitBox >= 0) {
+        glm::vec2 pushDelta = axis * (speed * dt);
+
+        if (tryMoveBox((size_t)hitBox, pushDelta, &movedBox) && (movedBox.x != 0 || movedBox.y != 0)) {
+            // กล่องขยับได้ -> ผู้เล่นตามไป "เท่าที่กล่องไปจริง"
+            glm::vec2 n; moveAndCollide(playerBox(), movedBox, grid, &n);
+        }
+        else {
+            // กล่องขยับไม่ได้ -> ผู้เล่นไม่ดันซ้อน ให้ slide ด้วยคอมโพเนนต์ที่ไม่ดันเข้ากล่อง
+            float vn = glm::dot(delta, axis);            // คอมโพเนนต์ที่ดันเข้ากล่อง
+            glm::vec2 deltaSlide = (vn > 0) ? (delta - axis * vn) : delta;  // ตัดเฉพาะถ้ากำลังดันเข้า
+            glm::vec2 n; moveAndCollide(playerBox(), deltaSlide, grid, &n);
+        }
+    }
+    else {
+        // ไม่มีลัง -> เดินปกติ (มี slide vs กำแพงอยู่แล้ว)
+        glm::vec2 n; moveAndCollide(playerBox(), delta, grid, &n);
+    }
+
+    // กันผู้เล่นซ้อนกล่อง (depenetration สั้น ๆ) — ผู้เล่นขยับได้ไม่เกิน ~1 ช่องต่อกล่องที่ชน
+    AABB& pb = playerBox();
+    glm::vec2 reach = pb.half * 2.0f + glm::vec2(1.0f);
+    boxHash.query(pb.center - pb.half - reach,
+                   pb.center + pb.half + reach, [&](int i) {
+        const AABB& box = crates.collider[i];
+        glm::vec2 aMin = pb.center - pb.half, aMax = pb.center + pb.half;
+        glm::vec2 bMin = box.center - box.half, bMax = box.center + box.half;
+        bool overlap = !(aMax.x<bMin.x || aMin.x>bMax.x || aMax.y<bMin.y || aMin.y>bMax.y);
+        if (overlap) {
+            // ดันผู้เล่นออกจากกล่องทางแกนซ้อนน้อยกว่า
+            float ox = std::min(aMax.x - bMin.x, bMax.x - aMin.x);
+            float oz = std::min(aMax.y - bMin.y, bMax.y - aMin.y);
+            if (ox < oz) pb.center.x += (pb.center.x < box.center.x ? -ox : +ox) * 1.001f;
+            else        pb.center.y += (pb.center.y < box.center.y ? -oz : +oz) * 1.001f;
+        }
+        return true;
+    });
+
+
+    // อัปเดตทิศเพื่อหมุนโมเดล
+    dir = glm::ivec2((in.x > 0.1f) - (in.x < -0.1f), (in.y > 0.1f) - (in.y < -0.1f));
+}
+
+void Simulation::snapshotPrevious() {
+    actors.snapshot();
+    crates.snapshot();
+}
+
+void Simulation::step(const SimInput& in) {
+    if (in.has(SimInput::Restart) && allCleared) restart();
+    else if (in.has(SimInput::Reload)) resetLevel();
+    else if (in.has(SimInput::Undo)) undoPush();
+    else if (in.has(SimInput::Redo)) redoPush();
+    snapshotPrevious();
+    handleInputAndMove(in, kFixedDt);
+    tick++;
+    // mapped levels: page in the grid chunks the player is heading into
+    grid.prefetchAround(glm::ivec2(glm::round(playerBox().center)));
+
+    // ----- WIN / LEVEL PROGRESSION -----
+    // build the next level in the background while the last crates go in,
+    // so the switch below only swaps it in
+    if (!allCleared && levelIndex + 1 < (int)levels.size() && cratesOnGoals + kPrepareGoalsLeft >= grid.goals.size())
+        prepareLevel(levelIndex + 1);
+    if (winAABB() && !allCleared) {
+        if (levelIndex < (int)levels.size() - 1) {
+            winTimer += kFixedDt;
+            if (winTimer >= 1.0f) {
+                levelIndex++;
+                loadCurrentLevel();
+            }
+        }
+        else {
+            allCleared = true;
+        }
+    }
+    history.endTick(playerBox().center);
+    if (recorder) recorder->tick(in, stateHash());
+}
+
+int Simulation::advance(float frameDt, const SimInput& in) {
+    accumulator += frameDt;
+    int ticks = 0;
+    while (accumulator >= kFixedDt && ticks < kMaxTicksPerAdvance) {
+        uint32_t serial = levelSerial;
+        SimInput tickIn = in;
+        if (ticks > 0) tickIn.buttons &= ~SimInput::kCommands;
+        step(tickIn);
+        ticks++;
+        if (levelSerial != serial) break;     // fresh level: accumulator was reset by the load
+        accumulator -= kFixedDt;
+    }
+    if (ticks == kMaxTicksPerAdvance) accumulator = std::fmod(accumulator, kFixedDt);
+    return ticks;
+}
+
+void Simulation::syncWorld(float a, JobSystem* jobs) {
+    // sync world from collider (ให้อนิเมชันไปทางเดียวกัน)
+    actors.interpolate(a);
+    if (jobs) jobs->parallelFor(crates.size(), 8192, [&](size_t b, size_t e) { crates.interpolate(a, b, e); });
+    else      crates.interpolate(a);
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "grid.h"
+#include "collision.h"
+#include "broadphase.h"
+#include "culling.h"
+#include "deadlock.h"
+#include "entity_store.h"
+#include "job_system.h"
+#include "level_collection.h"
+#include "level_pipeline.h"
+#include "undo_history.h"
+
+// Game logic without a window: level grid, entities, collision and level
+// progression. Runs on a fixed tick so results do not depend on frame rate;
+// the frontend feeds real frame time to advance() and draws interpolated
+// positions (EntityStore::world after syncWorld).
+
+struct ReplayRecorder;
+
+// held direction keys for one tick, plus one-shot level commands so that
+// everything that changes the simulation goes through step() (and replays)
+struct SimInput {
+    enum : uint8_t { Right = 1, Left = 2, Down = 4, Up = 8,    // Down = +Z, Up = -Z
+                     Reload = 16,                              // restart the current level
+                     Restart = 32,                             // back to level 1 once all are cleared
+                     Undo = 64, Redo = 128 };                  // one crate push back / forward
+    static constexpr uint8_t kCommands = Reload | Restart | Undo | Redo;
+    uint8_t buttons = 0;
+    bool has(uint8_t b) const { return (buttons & b) != 0; }
+};
+
+struct Simulation {
+    static constexpr int   kTickRate = 60;
+    static constexpr float kFixedDt  = 1.0f / kTickRate;
+    static constexpr int   kMaxTicksPerAdvance = 15;   // drop time instead of spiralling
+    // the next level starts building in the background once at most this
+    // many goals are left uncovered
+    static constexpr size_t kPrepareGoalsLeft = 1;
+
+    Grid grid;
+    EntityStore crates;             // one entity per grid box, rebuilt per level
+    EntityStore actors;             // the player (kept apart so crate slots stay dense)
+    EntityId player;
+    BodyHash boxHash;               // broadphase over crates (id = slot)
+    UndoHistory history;            // crate pushes since the level was (re)started
+    DeadlockAnalyzer deadlock;      // dead squares per level, checked after every crate move
+    TileChunks chunks;              // render culling groups over grid, rebuilt per level
+
+    glm::vec3 moveAnimStart{0,0,0};
+    glm::vec3 moveAnimEnd{0,0,0};
+    float moveT=1.0f; // 1 = idle
+    glm::ivec2 dir{0,0};
+
+    std::vector<std::string> levels;
+    int   levelIndex = 0;
+    bool  allCleared = false;
+    float winTimer = 0.0f;
+    uint32_t levelSerial = 0;       // bumps on every (re)load; frontends rebuild per-level data
+    uint64_t tick = 0;
+    ReplayRecorder* recorder = nullptr;     // when set, every step() is appended
+
+    // level pipeline: frontend hook, runs on the worker right after a level
+    // was prepared ahead; its result comes back as preparedRender once that
+    // level is current (null when the level was loaded on the spot)
+    std::function<std::shared_ptr<void>(const PreparedLevel&)> prepareRender;
+    std::shared_ptr<void> preparedRender;
+    struct LoadStats {
+        bool prepared = false;      // built ahead on the pipeline worker
+        double buildMs = 0.0;       // parse + collision/culling/dead squares
+        double waitMs = 0.0;        // waiting for the worker to finish
+        double hitchMs = 0.0;       // all of loadCurrentLevel, the visible stall
+    } lastLoad;
+
+    // ---- lifecycle ----
+    void loadCurrentLevel();
+    void restart();                 // back to the first level
+    void resetLevel();              // current level from its cached start state, no file I/O
+    bool undoPush();                // O(1); false when there is nothing to undo
+    bool redoPush();
+
+    // ---- fixed-step API ----
+    void step(const SimInput& in);  // exactly one tick of kFixedDt
+    // accumulate frame time, run whole ticks; returns ticks run. Command
+    // bits in `in` go to the first tick only, so keep them until this
+    // returns > 0.
+    int advance(float frameDt, const SimInput& in);
+    // fraction of a tick left in the accumulator, for render interpolation
+    float alpha() const { return accumulator / kFixedDt; }
+    // EntityStore::world = lerp(previous tick, current tick, alpha); crate
+    // ranges are spread over `jobs` when given
+    void syncWorld(float alpha, JobSystem* jobs = nullptr);
+
+    AABB& playerBox() { return actors.collider[actors.slot(player)]; }
+    const AABB& playerBox() const { return actors.collider[actors.slot(player)]; }
+    glm::vec3 playerWorld() const { return actors.world[actors.slot(player)]; }
+
+    // ---- queries ----
+    bool winAABB() const;
+    bool levelCleared() const { return !allCleared && winAABB(); }
+    // everything step() depends on or changes, as 64 bits (replay checks)
+    uint64_t stateHash() const;
+
+    // ---- movement ----
+    void handleInputAndMove(const SimInput& in, float dt);
+    bool tryMoveBox(size_t j, glm::vec2 delta, glm::vec2* movedOut);
+    void tryMoveDiscreteAABB(glm::ivec2 d);
+    bool cellFree(glm::ivec2 p) const;
+    void tryMove(glm::ivec2 d);
+
+private:
+    float accumulator = 0.0f;
+    size_t cratesOnGoals = 0;       // kept by loadCurrentLevel / tryMoveBox
+    uint64_t crateHash = 0;         // XOR of crateKey over all crates, same upkeep
+    std::vector<glm::ivec2> crateCells;    // rounded crate centres as the deadlock analyser knows them
+    LevelCollection collection;     // index of the .xsb/.sok the current level spec points into
+    LevelPipeline pipeline;         // next level, built ahead (uses collection while busy)
+
+    // start state of the current level, captured by loadCurrentLevel
+    std::vector<AABB> initialCrates;
+    AABB initialPlayer{};
+
+    void buildLevel(const std::string& spec, PreparedLevel& L);   // no Simulation state but collection
+    void prepareLevel(int index);
+    bool crateOnGoal(const AABB& box) const;
+    void setCrateCenter(size_t j, glm::vec2 c);     // keeps boxHash and the counters in step
+    void crateMoved(size_t j);                      // tells the analyser when the crate changed cell
+    void restoreStart(bool rehash);                 // resetLevel's work
+    void snapshotPrevious();
+};
@@ -0,0 +1,476 @@
+#include "solver.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+size_t peakResidentBytes(){
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS pmc{};
+    if(GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return (size_t)pmc.PeakWorkingSetSize;
+    return 0;
+#else
+    rusage ru{};
+    if(getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+#if defined(__APPLE__)
+    return (size_t)ru.ru_maxrss;          // bytes
+#else
+    return (size_t)ru.ru_maxrss * 1024;   // kilobytes
+#endif
+#endif
+}
+
+// ---------------------------------------------------------------- bitsets
+
+namespace {
+
+inline bool testBit(const std::vector<uint64_t>& b, int i){ return (b[i >> 6] >> (i & 63)) & 1; }
+inline void setBit(std::vector<uint64_t>& b, int i){ b[i >> 6] |= 1ull << (i & 63); }
+
+inline int lowestBit(const std::vector<uint64_t>& b){
+    for(size_t w=0; w<b.size(); ++w)
+        if(b[w]){
+#if defined(_MSC_VER)
+            unsigned long i; _BitScanForward64(&i, b[w]); return (int)(w*64 + i);
+#else
+            return (int)(w*64 + __builtin_ctzll(b[w]));
+#endif
+        }
+    return -1;
+}
+
+// dst |= src << k (towards higher cell indices)
+inline void orShiftUp(std::vector<uint64_t>& dst, const std::vector<uint64_t>& src, int k){
+    const int n = (int)src.size(), ws = k >> 6, bs = k & 63;
+    for(int i=n-1; i>=ws; --i){
+        uint64_t v = src[i - ws] << bs;
+        if(bs && i - ws - 1 >= 0) v |= src[i - ws - 1] >> (64 - bs);
+        dst[i] |= v;
+    }
+}
+// dst |= src >> k (towards lower cell indices)
+inline void orShiftDown(std::vector<uint64_t>& dst, const std::vector<uint64_t>& src, int k){
+    const int n = (int)src.size(), ws = k >> 6, bs = k & 63;
+    for(int i=0; i+ws<n; ++i){
+        uint64_t v = src[i + ws] >> bs;
+        if(bs && i + ws + 1 < n) v |= src[i + ws + 1] << (64 - bs);
+        dst[i] |= v;
+    }
+}
+
+// cells reachable from start through free; the padding column stops row wrap
+void floodFill(const std::vector<uint64_t>& free, int stride, int start,
+               std::vector<uint64_t>& reach, std::vector<uint64_t>& tmp){
+    std::fill(reach.begin(), reach.end(), 0);
+    setBit(reach, start);
+    for(;;){
+        tmp = reach;
+        orShiftUp(tmp, reach, 1);
+        orShiftDown(tmp, reach, 1);
+        orShiftUp(tmp, reach, stride);
+        orShiftDown(tmp, reach, stride);
+        bool grew = false;
+        for(size_t w=0; w<tmp.size(); ++w){
+            uint64_t v = tmp[w] & free[w];
+            grew |= (v != reach[w]);
+            reach[w] = v;
+        }
+        if(!grew) return;
+    }
+}
+
+uint64_t splitmix64(uint64_t& s){
+    uint64_t z = (s += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+} // namespace
+
+// ---------------------------------------------------------------- level
+
+bool SolverLevel::fromGrid(const Grid& g, SolverLevel& L, std::string* err){
+    auto fail = [&](const char* m){ if(err) *err = m; return false; };
+    L = SolverLevel{};
+    L.W = g.W; L.H = g.H; L.stride = g.W + 1;
+    if(L.W <= 0 || L.H <= 0) return fail("empty level");
+    if((size_t)L.stride * L.H > (1u << 20)) return fail("level too large for the solver");
+
+    const int n = L.cells();
+    std::vector<uint8_t> open(n, 0);
+    for(int y=0; y<L.H; ++y)
+        for(int x=0; x<L.W; ++x)
+            open[y*L.stride + x] = !g.isWall({x, y});
+
+    // playable area = everything the player can walk to with boxes ignored
+    L.player = g.player.y * L.stride + g.player.x;
+    if(g.player.x < 0 || g.player.x >= L.W || g.player.y < 0 || g.player.y >= L.H || !open[L.player])
+        return fail("player is not on a floor cell");
+    L.isFloor.assign(n, 0);
+    std::vector<int> stack{L.player};
+    L.isFloor[L.player] = 1;
+    const int dirs[4] = { 1, -1, L.stride, -L.stride };
+    while(!stack.empty()){
+        int c = stack.back(); stack.pop_back();
+        for(int d : dirs){
+            int m = c + d;
+            if(m >= 0 && m < n && open[m] && !L.isFloor[m]){ L.isFloor[m] = 1; stack.push_back(m); }
+        }
+    }
+    L.floorBits.assign(L.words(), 0);
+    for(int c=0; c<n; ++c) if(L.isFloor[c]) setBit(L.floorBits, c);
+
+    L.isGoal.assign(n, 0);
+    for(auto& p : g.goals){
+        int c = p.y * L.stride + p.x;
+        if(!L.isFloor[c]) return fail("goal outside the playable area");
+        L.isGoal[c] = 1; L.goals.push_back(c);
+    }
+    for(auto& p : g.boxes){
+        int c = p.y * L.stride + p.x;
+        if(!L.isFloor[c]) return fail("box outside the playable area");
+        L.boxes.push_back(c);
+    }
+    std::sort(L.boxes.begin(), L.boxes.end());
+    if(L.boxes.empty()) return fail("no boxes");
+    if(L.boxes.size() != L.goals.size()) return fail("solver needs as many boxes as goals");
+
+    // reverse pull BFS from every goal: a box at q came from q-d, with the
+    // player standing at q-2d. Unreached cells are dead squares.
+    L.goalDist.assign(n, kDead);
+    std::deque<int> q;
+    for(int c : L.goals){ L.goalDist[c] = 0; q.push_back(c); }
+    while(!q.empty()){
+        int c = q.front(); q.pop_front();
+        for(int d : dirs){
+            int from = c - d, stand = c - 2*d;
+            if(from < 0 || from >= n || stand < 0 || stand >= n) continue;
+            if(!L.isFloor[from] || !L.isFloor[stand] || L.goalDist[from] != kDead) continue;
+            L.goalDist[from] = (uint16_t)(L.goalDist[c] + 1);
+            q.push_back(from);
+        }
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------- search
+
+namespace {
+
+// upper bound on distinct (boxes, player) nodes: box sets over the live
+// cells times player cells
+double stateBound(const SolverLevel& L){
+    int floor = 0, live = 0;
+    for(int c=0; c<L.cells(); ++c)
+        if(L.isFloor[c]){ ++floor; live += !L.isDead(c); }
+    const int k = (int)L.boxes.size();
+    double b = 1.0;
+    for(int i=0; i<k && b < 1e18; ++i) b = b * (live - i) / (i + 1);
+    return b * std::max(1, floor - k);
+}
+
+// Lock-free transposition table: open addressing on a 64-bit key, value packs
+// (iteration << 32 | best g). An entry from an older iteration is stale.
+// Sized by the byte budget, but no bigger than twice the level's node bound
+// (small levels would otherwise zero the whole budget on every solve).
+class TransTable {
+public:
+    TransTable(size_t bytes, double states){
+        size_t n = 1024;
+        while(n * 2 * sizeof(Slot) <= bytes && (double)n < 2.0 * states) n *= 2;
+        slots.reset(new Slot[n]);
+        mask = n - 1;
+        count = n;
+    }
+    size_t bytes() const { return count * sizeof(Slot); }
+
+    // true = explore; false = already seen this iteration at g' <= g
+    bool admit(uint64_t hash, uint32_t g, uint32_t iter){
+        const uint64_t key = hash | 1;           // 0 marks an empty slot
+        const uint64_t mine = ((uint64_t)iter << 32) | g;
+        for(size_t p=0; p<kProbe; ++p){
+            Slot& s = slots[(key + p) & mask];
+            uint64_t k = s.key.load(std::memory_order_acquire);
+            if(k == 0){
+                if(!s.key.compare_exchange_strong(k, key, std::memory_order_acq_rel)) {
+                    if(k != key) continue;       // someone else took it
+                }
+                else k = key;
+            }
+            if(k != key) continue;
+            uint64_t v = s.val.load(std::memory_order_acquire);
+            for(;;){
+                if((uint32_t)(v >> 32) == iter && (uint32_t)v <= g) return false;
+                if(s.val.compare_exchange_weak(v, mine, std::memory_order_acq_rel)) return true;
+            }
+        }
+        return true;   // neighbourhood full: search on without pruning
+    }
+
+private:
+    struct Slot { std::atomic<uint64_t> key{0}; std::atomic<uint64_t> val{0}; };
+    static constexpr size_t kProbe = 8;
+    std::unique_ptr<Slot[]> slots;
+    size_t mask = 0, count = 0;
+};
+
+struct PushMove { int box; int dir; };   // box cell before the push
+
+struct Task {
+    std::vector<int> boxes;
+    int player;
+    int g, depth;
+    std::vector<PushMove> path;
+};
+
+struct alignas(64) Worker {
+    std::mutex m;
+    std::deque<Task> tasks;
+    uint64_t nodes = 0, steals = 0;
+    struct Frame { std::vector<int> boxes; std::vector<uint64_t> boxBits, freeBits, reach; };
+    std::vector<Frame> frames;
+    std::vector<uint64_t> tmp;
+    std::vector<PushMove> path;
+};
+
+class Search {
+public:
+    Search(const SolverLevel& L, const SolverOptions& o, int threads)
+        : L(L), opt(o), tt(o.ttMegabytes * 1024 * 1024, stateBound(L)), workers(threads) {
+        uint64_t seed = 0x5eed5eedull;
+        zBox.resize(L.cells()); zPlayer.resize(L.cells());
+        for(auto& z : zBox) z = splitmix64(seed);
+        for(auto& z : zPlayer) z = splitmix64(seed);
+        dirs[0] = 1; dirs[1] = -1; dirs[2] = L.stride; dirs[3] = -L.stride;
+        for(auto& w : workers){
+            w = std::make_unique<Worker>();
+            w->frames.resize(opt.maxPushes + 2);   // bitsets allocated on first use of a depth
+            w->tmp.assign(L.words(), 0);
+        }
+        start = std::chrono::steady_clock::now();
+    }
+
+    SolverResult run(){
+        SolverResult r;
+        r.threads = (int)workers.size();
+        r.ttBytes = tt.bytes();
+
+        int threshold = heuristic(L.boxes);
+        for(uint32_t it=1; ; ++it){
+            if(threshold > opt.maxPushes) break;
+            r.iterations = (int)it;
+            bound = threshold;
+            iter = it;
+            nextBound.store(kInf);
+            pending.store(1);
+            workers[0]->tasks.push_back(Task{ L.boxes, L.player, 0, 0, {} });
+
+            std::vector<std::thread> pool;
+            for(size_t i=1; i<workers.size(); ++i) pool.emplace_back([this, i]{ workerLoop((int)i); });
+            workerLoop(0);
+            for(auto& t : pool) t.join();
+            for(auto& w : workers) w->tasks.clear();
+
+            if(found || stop.load()) break;
+            int nb = nextBound.load();
+            if(nb == kInf){ r.provedUnsolvable = true; break; }
+            threshold = nb;
+        }
+
+        for(auto& w : workers){ r.nodes += w->nodes; r.steals += w->steals; }
+        r.seconds = elapsed();
+        r.timedOut = timedOut.load();
+        if(found){
+            r.solved = true;
+            r.pushes = (int)solution.size();
+            r.lurd = toLurd(solution);
+            r.moves = (int)r.lurd.size();
+        }
+        r.peakRssBytes = peakResidentBytes();
+        return r;
+    }
+
+private:
+    static constexpr int kInf = 0x7fffffff;
+
+    const SolverLevel& L;
+    SolverOptions opt;
+    TransTable tt;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<uint64_t> zBox, zPlayer;
+    int dirs[4];
+    int bound = 0;
+    uint32_t iter = 0;
+    std::atomic<int> nextBound{kInf};
+    std::atomic<int> pending{0};
+    std::atomic<bool> stop{false}, timedOut{false};
+    bool found = false;
+    std::mutex solMutex;
+    std::vector<PushMove> solution;
+    std::chrono::steady_clock::time_point start;
+
+    double elapsed() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    int heuristic(const std::vector<int>& boxes) const {
+        int h = 0;
+        for(int c : boxes) h += L.goalDist[c];
+        return h;
+    }
+
+    void workerLoop(int id){
+        Worker& w = *workers[id];
+        for(;;){
+            if(stop.load(std::memory_order_relaxed)) return;
+            Task t;
+            bool got = false;
+            {
+                std::lock_guard<std::mutex> lk(w.m);
+                if(!w.tasks.empty()){ t = std::move(w.tasks.back()); w.tasks.pop_back(); got = true; }
+            }
+            for(size_t k=1; !got && k<workers.size(); ++k){
+                Worker& v = *workers[(id + k) % workers.size()];
+                std::lock_guard<std::mutex> lk(v.m);
+                if(!v.tasks.empty()){ t = std::move(v.tasks.front()); v.tasks.pop_front(); got = true; w.steals++; }
+            }
+            if(!got){
+                if(pending.load() == 0) return;
+                std::this_thread::yield();
+                continue;
+            }
+            w.frames[t.g].boxes = std::move(t.boxes);
+            w.path = std::move(t.path);
+            dfs(w, t.g, t.depth, t.player);
+            pending.fetch_sub(1);
+        }
+    }
+
+    void spawn(Worker& w, const std::vector<int>& boxes, int player, int g, int depth){
+        pending.fetch_add(1);
+        std::lock_guard<std::mutex> lk(w.m);
+        w.tasks.push_back(Task{ boxes, player, g, depth, w.path });
+    }
+
+    void dfs(Worker& w, int g, int depth, int playerCell){
+        if(stop.load(std::memory_order_relaxed)) return;
+        if((++w.nodes & 4095) == 0 && opt.timeLimitSec > 0 && elapsed() > opt.timeLimitSec){
+            timedOut = true; stop = true; return;
+        }
+        auto& f = w.frames[g];
+        const auto& boxes = f.boxes;
+
+        int h = heuristic(boxes);
+        if(h == 0){   // every box on a goal
+            std::lock_guard<std::mutex> lk(solMutex);
+            if(!found){ found = true; solution = w.path; }
+            stop = true;
+            return;
+        }
+        if(g + h > bound){
+            int nb = nextBound.load();
+            while(g + h < nb && !nextBound.compare_exchange_weak(nb, g + h)) {}
+            return;
+        }
+
+        if(f.reach.empty()){
+            f.boxBits.assign(L.words(), 0); f.freeBits.assign(L.words(), 0); f.reach.assign(L.words(), 0);
+        }
+        std::fill(f.boxBits.begin(), f.boxBits.end(), 0);
+        for(int c : boxes) setBit(f.boxBits, c);
+        for(size_t i=0; i<f.freeBits.size(); ++i) f.freeBits[i] = L.floorBits[i] & ~f.boxBits[i];
+        floodFill(f.freeBits, L.stride, playerCell, f.reach, w.tmp);
+        int norm = lowestBit(f.reach);
+
+        uint64_t hash = zPlayer[norm];
+        for(int c : boxes) hash ^= zBox[c];
+        if(!tt.admit(hash, (uint32_t)g, iter)) return;
+        if(g + 1 > opt.maxPushes) return;
+
+        auto& child = w.frames[g + 1];
+        for(size_t i=0; i<boxes.size(); ++i){
+            for(int d=0; d<4; ++d){
+                int b = boxes[i], from = b - dirs[d], to = b + dirs[d];
+                if(from < 0 || to < 0 || from >= L.cells() || to >= L.cells()) continue;
+                if(!testBit(f.reach, from)) continue;
+                if(!L.isFloor[to] || testBit(f.boxBits, to) || L.isDead(to)) continue;
+
+                child.boxes = boxes;
+                child.boxes[i] = to;
+                std::sort(child.boxes.begin(), child.boxes.end());
+                w.path.push_back({ b, d });
+                if(depth < opt.splitDepth) spawn(w, child.boxes, b, g + 1, depth + 1);
+                else dfs(w, g + 1, depth + 1, b);
+                w.path.pop_back();
+                if(stop.load(std::memory_order_relaxed)) return;
+            }
+        }
+    }
+
+    // replay pushes from the start position, walking the player between them
+    std::string toLurd(const std::vector<PushMove>& pushes) const {
+        static const char walk[4] = { 'r', 'l', 'u', 'd' };   // +x, -x, +y (up), -y
+        std::string out;
+        std::vector<uint8_t> box(L.cells(), 0);
+        for(int c : L.boxes) box[c] = 1;
+        int player = L.player;
+        std::vector<int> prev(L.cells());
+        for(const auto& p : pushes){
+            int target = p.box - dirs[p.dir];
+            // BFS player -> target around boxes
+            std::fill(prev.begin(), prev.end(), -1);
+            std::deque<int> q{player};
+            prev[player] = player;
+            while(!q.empty() && prev[target] < 0){
+                int c = q.front(); q.pop_front();
+                for(int d=0; d<4; ++d){
+                    int m = c + dirs[d];
+                    if(m < 0 || m >= L.cells() || prev[m] >= 0 || !L.isFloor[m] || box[m]) continue;
+                    prev[m] = c; q.push_back(m);
+                }
+            }
+            std::string leg;
+            for(int c=target; c!=player; c=prev[c]){
+                int from = prev[c];
+                for(int d=0; d<4; ++d) if(from + dirs[d] == c){ leg.push_back(walk[d]); break; }
+            }
+            out.append(leg.rbegin(), leg.rend());
+            out.push_back((char)(walk[p.dir] - 'a' + 'A'));
+            box[p.box] = 0; box[p.box + dirs[p.dir]] = 1;
+            player = p.box;
+        }
+        return out;
+    }
+};
+
+} // namespace
+
+SolverResult solveLevel(const SolverLevel& level, const SolverOptions& opt){
+    int threads = opt.threads > 0 ? opt.threads : (int)std::max(1u, std::thread::hardware_concurrency());
+    // a box on a dead square can never reach a goal: no search needed
+    for(int c : level.boxes)
+        if(level.isDead(c)){
+            SolverResult r;
+            r.provedUnsolvable = true;
+            r.threads = threads;
+            r.peakRssBytes = peakResidentBytes();
+            return r;
+        }
+    Search s(level, opt, threads);
+    return s.run();
+}
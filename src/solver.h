@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "grid.h"
+
+// Push-optimal Sokoban solver over the Grid level format.
+//
+// Search is parallel IDA* on push moves: a node is (sorted box cells, player
+// region) where the region is normalised to its lowest reachable cell by a
+// bit-parallel flood fill. Nodes are Zobrist-hashed into a lock-free
+// transposition table shared by all workers. Boxes are never pushed onto dead
+// squares (cells no pull sequence from a goal can reach). Each iteration
+// splits the first few plies into tasks on per-thread deques; idle threads
+// steal from the others.
+
+struct SolverLevel {
+    int W=0, H=0, stride=0;              // cell = y*stride + x; column W is padding
+    std::vector<uint64_t> floorBits;     // reachable non-wall cells, 1 bit per cell
+    std::vector<uint8_t>  isFloor, isGoal;
+    std::vector<uint16_t> goalDist;      // min pushes to any goal ignoring other boxes; kDead if none
+    std::vector<int> goals;
+    std::vector<int> boxes;              // sorted
+    int player = 0;
+
+    static constexpr uint16_t kDead = 0xFFFF;
+
+    int cells() const { return stride * H; }
+    int words() const { return (cells() + 63) / 64; }
+    bool isDead(int c) const { return goalDist[c] == kDead; }
+
+    // false + message when the grid is not a level the solver takes; levels
+    // that merely cannot be solved come back from solveLevel as unsolvable
+    static bool fromGrid(const Grid& g, SolverLevel& out, std::string* err);
+};
+
+struct SolverOptions {
+    int threads = 0;                 // 0 = hardware_concurrency
+    size_t ttMegabytes = 256;
+    int maxPushes = 1000;            // IDA* gives up above this bound
+    double timeLimitSec = 0.0;       // 0 = none
+    int splitDepth = 5;              // plies below each iteration root handed out as tasks
+};
+
+struct SolverResult {
+    bool solved = false;
+    bool provedUnsolvable = false;   // search space exhausted without a solution
+    bool timedOut = false;
+    int pushes = -1;
+    int moves = -1;
+    std::string lurd;                // lowercase = walk, uppercase = push
+    uint64_t nodes = 0;
+    uint64_t steals = 0;
+    int iterations = 0;
+    int threads = 0;
+    double seconds = 0.0;
+    size_t ttBytes = 0;
+    size_t peakRssBytes = 0;         // 0 if the platform does not report it
+};
+
+SolverResult solveLevel(const SolverLevel& level, const SolverOptions& opt = {});
+
+// peak resident set size of this process in bytes (0 if unknown)
+size_t peakResidentBytes();
@@ -0,0 +1,70 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+
+// Undo/redo for crate pushes. One entry per push: the crate slot, where the
+// crate and the player were when the push started and where they ended up.
+// Consecutive ticks pushing the same crate extend the open entry; a tick
+// without a push closes it. Entries live in a ring allocated once, so
+// recording never allocates; when it is full the oldest push is dropped.
+//
+// Undo/redo are O(1): they hand back one entry, the caller moves one crate
+// and the player. Anything recorded after an undo discards the redo tail.
+struct UndoHistory {
+    struct Push {
+        uint32_t crate = 0;
+        glm::vec2 crateFrom{0}, crateTo{0};
+        glm::vec2 playerFrom{0}, playerTo{0};
+    };
+
+    explicit UndoHistory(uint32_t capacity = 4096)
+        : cap(capacity ? capacity : 1), ring(new Push[cap]) {}
+
+    void clear(){ first = cursor = last = 0; open = false; }
+
+    // a crate moved this tick; playerAt = player centre before it moved
+    void onPush(uint32_t crate, glm::vec2 from, glm::vec2 to, glm::vec2 playerAt){
+        if(open && ring[(cursor - 1) % cap].crate == crate){
+            ring[(cursor - 1) % cap].crateTo = to;
+            pushedThisTick = true;
+            return;
+        }
+        if(cursor - first == cap) ++first;          // full: forget the oldest
+        ring[cursor % cap] = { crate, from, to, playerAt, playerAt };
+        ++cursor;
+        last = cursor;                              // new history, no redo
+        open = true;
+        pushedThisTick = true;
+    }
+    // end of a tick: the open push records where the player ended up, and
+    // closes once a tick passes without pushing
+    void endTick(glm::vec2 player){
+        if(open) ring[(cursor - 1) % cap].playerTo = player;
+        open = open && pushedThisTick;
+        pushedThisTick = false;
+    }
+
+    bool canUndo() const { return cursor > first; }
+    bool canRedo() const { return last > cursor; }
+    // entry to revert (crate -> crateFrom, player -> playerFrom)
+    const Push* undo(){
+        if(!canUndo()) return nullptr;
+        open = false;
+        return &ring[--cursor % cap];
+    }
+    // entry to re-apply (crate -> crateTo, player -> playerTo)
+    const Push* redo(){
+        if(!canRedo()) return nullptr;
+        open = false;
+        return &ring[cursor++ % cap];
+    }
+    uint32_t capacity() const { return cap; }
+    uint64_t undoDepth() const { return cursor - first; }
+
+private:
+    uint32_t cap;
+    std::unique_ptr<Push[]> ring;
+    uint64_t first = 0, cursor = 0, last = 0;       // [first, cursor) undoable, [cursor, last) redoable
+    bool open = false, pushedThisTick = false;
+};
@@ -0,0 +1,94 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Per-frame shader data, mirrors `layout(std140) uniform Frame` in
+// shaders/basic.*. vec3 values travel as vec4 (std140 pads them anyway).
+struct FrameUniforms {
+    static constexpr GLuint kBinding = 0;
+    glm::mat4 view;
+    glm::mat4 proj;
+    glm::vec4 camPos;      // xyz
+    glm::vec4 lightDir;    // xyz
+    glm::vec4 lightColor;  // xyz
+};
+static_assert(sizeof(FrameUniforms) == 176, "FrameUniforms must match the std140 Frame block");
+
+// N slots in one uniform buffer, one slot per frame in flight.
+// GL 4.4 / ARB_buffer_storage: mapped once (persistent, coherent), each slot
+// fenced so the CPU never overwrites data the GPU may still read.
+// Plain GL 3.3: glBufferSubData into the next slot.
+struct UniformRing {
+    GLuint ubo = 0;
+    GLuint binding = 0;
+    GLsizeiptr blockSize = 0, stride = 0;
+    int slots = 0, slot = -1;
+    uint8_t* mapped = nullptr;
+    std::vector<GLsync> fences;
+
+    bool persistent() const { return mapped != nullptr; }
+
+    void init(GLsizeiptr size, GLuint bindingPoint, int slotCount = 3){
+        blockSize = size; binding = bindingPoint; slots = slotCount;
+        GLint align = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+        stride = (size + align - 1) / align * align;
+        fences.assign(slots, nullptr);
+
+        const GLsizeiptr total = stride * slots;
+        glGenBuffers(1, &ubo);
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+#ifdef GL_MAP_PERSISTENT_BIT
+        // glad declares a GLAD_GL_* flag only for what it was generated with
+        bool storage = false;
+#if defined(GL_VERSION_4_4)
+        storage = storage || GLAD_GL_VERSION_4_4;
+#endif
+#if defined(GL_ARB_buffer_storage)
+        storage = storage || GLAD_GL_ARB_buffer_storage;
+#endif
+        if(storage){
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_UNIFORM_BUFFER, total, nullptr, flags);
+            mapped = (uint8_t*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, total, flags);
+        }
+#endif
+        if(!mapped) glBufferData(GL_UNIFORM_BUFFER, total, nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    // write the next slot and bind it to the block's binding point
+    void push(const void* data){
+        slot = (slot + 1) % slots;
+        const GLintptr off = (GLintptr)slot * stride;
+        if(mapped){
+            if(GLsync f = fences[slot]){
+                while(glClientWaitSync(f, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+                glDeleteSync(f);
+                fences[slot] = nullptr;
+            }
+            std::memcpy(mapped + off, data, (size_t)blockSize);
+        } else {
+            glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+            glBufferSubData(GL_UNIFORM_BUFFER, off, blockSize, data);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding, ubo, off, blockSize);
+    }
+
+    // after the frame's draws: fence the slot they read from
+    void endFrame(){
+        if(mapped && slot >= 0) fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    void destroy(){
+        for(auto& f : fences) if(f){ glDeleteSync(f); f = nullptr; }
+        if(ubo){
+            if(mapped){ glBindBuffer(GL_UNIFORM_BUFFER, ubo); glUnmapBuffer(GL_UNIFORM_BUFFER); mapped = nullptr; }
+            glDeleteBuffers(1, &ubo); ubo = 0;
+        }
+    }
+};
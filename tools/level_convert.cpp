@@ -0,0 +1,45 @@
+// Compile text levels (or one level of a .xsb/.sok collection) into the
+// binary .sokb format (level_file.h) that Grid::load maps in place.
+//   level_convert in.txt out.sokb
+//   level_convert pack.xsb#12 out.sokb      one level of a collection
+//   level_convert --list pack.xsb           index a collection, print titles
+#include "grid.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+static int list(const char* path){
+    LevelCollection c;
+    if(!c.open(path)){ std::fprintf(stderr, "%s: cannot read\n", path); return 1; }
+    for(size_t i=0; i<c.size(); ++i){
+        std::string_view t = c.title(i);
+        std::printf("%s#%zu\t%.*s\n", path, i + 1, (int)t.size(), t.data());
+    }
+    std::fprintf(stderr, "%s: %zu levels, indexed in %.2f ms\n", path, c.size(), c.indexMs);
+    return 0;
+}
+
+int main(int argc, char** argv){
+    if(argc == 3 && !std::strcmp(argv[1], "--list")) return list(argv[2]);
+    if(argc != 3){
+        std::fprintf(stderr, "usage: level_convert in.txt|pack.xsb#N out.sokb\n       level_convert --list pack.xsb\n");
+        return 2;
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    Grid g;
+    if(!g.load(argv[1])){ std::fprintf(stderr, "%s: cannot read\n", argv[1]); return 1; }
+    double parseMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    if(!g.saveBinary(argv[2])){ std::fprintf(stderr, "%s: cannot write\n", argv[2]); return 1; }
+
+    // reload to check the file and show what a level switch now costs
+    auto t1 = std::chrono::steady_clock::now();
+    Grid check;
+    if(!check.load(argv[2]) || check.W != g.W || check.H != g.H || check.boxes != g.boxes || check.goals != g.goals){
+        std::fprintf(stderr, "%s: reload does not match\n", argv[2]);
+        return 1;
+    }
+    double mapMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t1).count();
+    std::printf("%s -> %s: %dx%d, %zu crates, %zu goals; text load %.2f ms, binary load %.2f ms\n",
+                argv[1], argv[2], g.W, g.H, g.boxes.size(), g.goals.size(), parseMs, mapMs);
+    return 0;
+}
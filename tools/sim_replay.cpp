@@ -0,0 +1,55 @@
+// Replays recorded sessions (.rep, see replay.h) through the simulation with
+// no window, as fast as the CPU allows. Checks the recorded state hashes and
+// reports ticks/sec; exit code 1 when any replay diverges or cannot run.
+//   sim_replay [--no-verify] [--repeat N] replays...
+#include "replay.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv){
+    bool verify = true;
+    int repeat = 1;
+    std::vector<const char*> files;
+    for(int i=1;i<argc;++i){
+        if(!std::strcmp(argv[i], "--no-verify")) verify = false;
+        else if(!std::strcmp(argv[i], "--repeat") && i+1<argc) repeat = std::max(1, std::atoi(argv[++i]));
+        else files.push_back(argv[i]);
+    }
+    if(files.empty()){
+        std::fprintf(stderr, "usage: sim_replay [--no-verify] [--repeat N] replays...\n");
+        return 2;
+    }
+
+    int failed = 0;
+    for(const char* path : files){
+        Replay r;
+        std::string err;
+        if(!r.load(path, &err)){ std::fprintf(stderr, "%s\n", err.c_str()); ++failed; continue; }
+
+        // best of N: the first run also pays for page faults and cold caches
+        ReplayResult best;
+        for(int k=0; k<repeat; ++k){
+            Simulation sim;
+            ReplayResult res = runReplay(r, sim, verify);
+            if(!res.error.empty() || res.diverged || k == 0 || res.seconds < best.seconds) best = res;
+            if(!res.error.empty() || res.diverged) break;
+        }
+
+        if(!best.error.empty()){
+            std::printf("%-32s ERROR     %s\n", path, best.error.c_str());
+            ++failed;
+        } else if(best.diverged){
+            std::printf("%-32s DIVERGED  at tick %llu of %llu\n", path,
+                        (unsigned long long)best.divergedAt, (unsigned long long)r.ticks);
+            ++failed;
+        } else {
+            std::printf("%-32s %s  %10llu ticks  %8.3f s  %12.0f ticks/sec\n", path, verify ? "OK      " : "UNCHECKED",
+                        (unsigned long long)best.ticks, best.seconds, best.ticksPerSecond());
+        }
+    }
+    return failed ? 1 : 0;
+}
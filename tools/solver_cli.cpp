@@ -0,0 +1,48 @@
+// Solve level files with the parallel push-optimal solver and report
+// search statistics for tracking performance across versions.
+//   sokoban_solve [--threads N] [--tt-mb M] [--max-pushes P] [--time S] [--lurd] level...
+#include "solver.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+int main(int argc, char** argv){
+    SolverOptions opt;
+    bool printLurd = false;
+    std::vector<const char*> files;
+    for(int i=1;i<argc;++i){
+        if(!std::strcmp(argv[i], "--threads") && i+1<argc) opt.threads = std::atoi(argv[++i]);
+        else if(!std::strcmp(argv[i], "--tt-mb") && i+1<argc) opt.ttMegabytes = (size_t)std::atoll(argv[++i]);
+        else if(!std::strcmp(argv[i], "--max-pushes") && i+1<argc) opt.maxPushes = std::atoi(argv[++i]);
+        else if(!std::strcmp(argv[i], "--time") && i+1<argc) opt.timeLimitSec = std::atof(argv[++i]);
+        else if(!std::strcmp(argv[i], "--lurd")) printLurd = true;
+        else files.push_back(argv[i]);
+    }
+    if(files.empty()){
+        std::fprintf(stderr, "usage: sokoban_solve [--threads N] [--tt-mb M] [--max-pushes P] [--time S] [--lurd] level...\n");
+        return 2;
+    }
+
+    int failures = 0;
+    for(const char* path : files){
+        Grid g;
+        SolverLevel level;
+        std::string err;
+        if(!g.load(path)){ std::printf("%s: cannot read\n", path); failures++; continue; }
+        if(!SolverLevel::fromGrid(g, level, &err)){ std::printf("%s: %s\n", path, err.c_str()); failures++; continue; }
+
+        SolverResult r = solveLevel(level, opt);
+        const char* status = r.solved ? "solved" : r.provedUnsolvable ? "UNSOLVABLE" : r.timedOut ? "timeout" : "no solution within bound";
+        std::printf("%s: %s\n", path, status);
+        if(r.solved) std::printf("  pushes        %d\n  moves         %d\n", r.pushes, r.moves);
+        std::printf("  nodes         %llu\n", (unsigned long long)r.nodes);
+        std::printf("  nodes/sec     %.0f\n", r.nodes / std::max(r.seconds, 1e-9));
+        std::printf("  time          %.3f s (%d iterations, %d threads, %llu steals)\n",
+                    r.seconds, r.iterations, r.threads, (unsigned long long)r.steals);
+        std::printf("  tt            %.1f MiB\n", r.ttBytes / (1024.0 * 1024.0));
+        if(r.peakRssBytes) std::printf("  peak memory   %.1f MiB\n", r.peakRssBytes / (1024.0 * 1024.0));
+        if(printLurd && r.solved) std::printf("  solution      %s\n", r.lurd.c_str());
+        if(!r.solved) failures++;
+    }
+    return failures ? 1 : 0;
+}